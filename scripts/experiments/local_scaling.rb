@@ -0,0 +1,124 @@
+#!/usr/bin/env ruby
+
+# Strong scaling on a single machine: runs the distributed binaries in thrill's
+# local mode with 1..N workers and several block sizes and prints speedup and
+# efficiency tables. The raw logs are kept in the output directory and can be
+# fed to scripts/analyze/report_to_json.rb.
+#
+# usage: local_scaling.rb [options]
+#   e.g. local_scaling.rb -b release -g 'generate:lfr:n=1000000,mixing=0.4' -w 1,2,4,8,16 -k 128,1024
+
+require 'optparse'
+require 'open3'
+require 'fileutils'
+
+options = {
+  build_dir: 'release',
+  graph: 'generate:lfr:n=1000000,mixing=0.4',
+  binaries: %w(dlslm dlslm_map_eq dlplm label_prop),
+  workers: [1, 2, 4, 8].select { |w| w <= (`nproc`.to_i rescue 1) },
+  block_sizes: [nil],
+  repetitions: 1,
+  seed: 42,
+  output: "local_scaling_#{Time.now.strftime '%Y-%m-%d_%H-%M-%S'}"
+}
+
+OptionParser.new do |opts|
+  opts.banner = "usage: #{$0} [options]"
+  opts.on('-b', '--build-dir DIR', 'Directory containing the binaries') { |v| options[:build_dir] = v }
+  opts.on('-g', '--graph GRAPH', 'Graph file or generate:<spec>') { |v| options[:graph] = v }
+  opts.on('-a', '--binaries LIST', Array, 'Binaries to run') { |v| options[:binaries] = v }
+  opts.on('-w', '--workers LIST', Array, 'Worker counts, the first one is the baseline') { |v| options[:workers] = v.map(&:to_i) }
+  opts.on('-k', '--block-sizes LIST', Array, 'THRILL_BLOCK_SIZE values in KiB') { |v| options[:block_sizes] = v.map { |it| it.to_i * 1024 } }
+  opts.on('-r', '--repetitions N', Integer, 'Runs per configuration, the median is used') { |v| options[:repetitions] = v }
+  opts.on('-s', '--seed N', Integer, 'SEED passed to the binaries') { |v| options[:seed] = v }
+  opts.on('-o', '--output DIR', 'Directory for the raw logs') { |v| options[:output] = v }
+end.parse!
+
+FileUtils.mkdir_p options[:output]
+
+def parse_log output
+  data = Hash.new { |hash, type| hash[type] = Hash.new { |h, id| h[id] = {} } }
+  output.each_line do |line|
+    next unless line.start_with? '#LOG# '
+    key, value = line[6..-1].split(':', 2).map(&:strip)
+    type, id, attribute = key.split('/')
+    data[type][id][attribute] = (Float(value) rescue value)
+  end
+  data
+end
+
+# sum over all levels of the slowest worker per phase
+def phase_times data
+  data['algorithm_level'].values.each_with_object(Hash.new(0.0)) do |level, times|
+    %w(local_moving contraction label_exchange).each do |phase|
+      times[phase] += level["#{phase}_time_max"] if level["#{phase}_time_max"].is_a? Float
+    end
+  end
+end
+
+def median values
+  sorted = values.sort
+  sorted[sorted.size / 2]
+end
+
+results = Hash.new { |hash, key| hash[key] = {} }
+
+options[:binaries].each do |binary|
+  executable = File.join(options[:build_dir], binary)
+  abort "#{executable} not found" unless File.executable? executable
+
+  options[:block_sizes].each do |block_size|
+    options[:workers].each do |workers|
+      env = {
+        'THRILL_LOCAL' => '1',
+        'THRILL_WORKERS_PER_HOST' => workers.to_s,
+        'SEED' => options[:seed].to_s,
+        'LOGGING_SYNC' => '1'
+      }
+      env['THRILL_BLOCK_SIZE'] = block_size.to_s if block_size
+
+      runs = options[:repetitions].times.map do |repetition|
+        log_file = File.join(options[:output], "#{binary}_w#{workers}_b#{block_size || 'default'}_r#{repetition}.log")
+        start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+        output, status = Open3.capture2e(env, executable, options[:graph])
+        wall_time = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+        File.write log_file, output
+        warn "#{binary} with #{workers} workers failed, see #{log_file}" unless status.success?
+
+        data = parse_log output
+        algorithm_run = data['algorithm_run'].values.find { |run| run['start_ts'].is_a?(Float) && run['done_ts'].is_a?(Float) }
+        {
+          wall_time: wall_time,
+          # label_prop reports no algorithm run, fall back to the wall time of the whole process
+          algorithm_time: algorithm_run ? (algorithm_run['done_ts'] - algorithm_run['start_ts']) / 1_000_000 : wall_time,
+          phases: phase_times(data)
+        }
+      end
+
+      results[[binary, block_size]][workers] = {
+        wall_time: median(runs.map { |run| run[:wall_time] }),
+        algorithm_time: median(runs.map { |run| run[:algorithm_time] }),
+        phases: runs.min_by { |run| run[:algorithm_time] }[:phases]
+      }
+      $stderr.puts "#{binary} block size #{block_size || 'default'} workers #{workers}: #{'%.3f' % results[[binary, block_size]][workers][:algorithm_time]}s"
+    end
+  end
+end
+
+puts "graph: #{options[:graph]}"
+results.each do |(binary, block_size), by_workers|
+  puts
+  puts "#{binary}, block size #{block_size ? "#{block_size / 1024} KiB" : 'default'}"
+  puts '%8s %12s %12s %9s %11s %14s %14s %16s' % %w(workers wall_time algo_time speedup efficiency local_moving contraction label_exchange)
+  base_workers = by_workers.keys.min
+  base = by_workers[base_workers][:algorithm_time]
+  by_workers.sort.each do |workers, result|
+    speedup = base / result[:algorithm_time]
+    efficiency = speedup * base_workers / workers
+    puts '%8d %12.3f %12.3f %9.2f %11.2f %14.3f %14.3f %16.3f' % [
+      workers, result[:wall_time], result[:algorithm_time], speedup, efficiency,
+      result[:phases]['local_moving'], result[:phases]['contraction'], result[:phases]['label_exchange']
+    ]
+  end
+end
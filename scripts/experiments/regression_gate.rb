@@ -0,0 +1,137 @@
+#!/usr/bin/env ruby
+
+# Performance regression gate: runs a fixed set of algorithms on generated graphs
+# and compares runtime, peak memory, modularity and map equation against the
+# checked-in baseline (regression_baseline.json next to this script).
+# Exits with 1 if any value is worse than the baseline by more than its tolerance,
+# is not reported by the binary or has no baseline. Values a case lists as skipped
+# (not recorded on the reference machine yet) are only printed.
+#
+# usage: regression_gate.rb [--build-dir DIR] [--update] [--repetitions N]
+#   --update records the current values as new baseline, run it on the reference machine.
+# `make regression_gate` in the build directory builds the binaries and runs this.
+
+require 'optparse'
+require 'open3'
+require 'json'
+require 'tmpdir'
+require 'fileutils'
+
+options = {
+  build_dir: 'release',
+  baseline: File.join(File.dirname(File.expand_path(__FILE__)), 'regression_baseline.json'),
+  update: false,
+  repetitions: 3
+}
+
+OptionParser.new do |opts|
+  opts.banner = "usage: #{$0} [options]"
+  opts.on('-b', '--build-dir DIR', 'Directory containing the binaries') { |v| options[:build_dir] = v }
+  opts.on('-f', '--baseline FILE', 'Baseline file') { |v| options[:baseline] = v }
+  opts.on('-u', '--update', 'Write the measured values as new baseline') { options[:update] = true }
+  opts.on('-r', '--repetitions N', Integer, 'Runs per case, the fastest one is compared') { |v| options[:repetitions] = v }
+end.parse!
+
+baseline = JSON.parse(File.read(options[:baseline]))
+tolerances = baseline['tolerances']
+
+def parse_log output
+  data = Hash.new { |hash, type| hash[type] = Hash.new { |h, id| h[id] = {} } }
+  output.each_line do |line|
+    next unless line.start_with? '#LOG# '
+    key, value = line[6..-1].split(':', 2).map(&:strip)
+    type, id, attribute = key.split('/')
+    data[type][id][attribute] = (Float(value) rescue value)
+  end
+  data
+end
+
+def measurements data
+  run = data['algorithm_run'].values.first || {}
+  runtime = run['runtime'] || (run['done_ts'] && run['start_ts'] && (run['done_ts'] - run['start_ts']) / 1_000_000)
+  peak_rss = data['algorithm_level'].values.map { |level| level['peak_rss_max'] || level['peak_rss'] }.compact.max
+  clustering = data['clustering'].values.find { |it| it['source'] == 'computation' } || {}
+  {
+    'runtime' => runtime,
+    'peak_rss' => peak_rss,
+    'modularity' => clustering['modularity'],
+    'map_equation' => clustering['map_equation']
+  }
+end
+
+def run env, *command
+  output, status = Open3.capture2e(env, *command)
+  abort "#{command.join(' ')} failed:\n#{output}" unless status.success?
+  output
+end
+
+thrill_env = { 'THRILL_LOCAL' => '1', 'THRILL_WORKERS_PER_HOST' => (baseline['workers'] || 4).to_s, 'LOGGING_SYNC' => '1' }
+binary = ->(name) { File.join(options[:build_dir], name) }
+
+failures = []
+missing = []
+Dir.mktmpdir('regression_gate') do |dir|
+  graphs = {}
+  baseline['graphs'].each do |name, spec|
+    run thrill_env, binary['generate_graph'], spec, File.join(dir, "#{name}-@@@@-#####.bin")
+    graphs[name] = File.join(dir, "#{name}-*.bin")
+  end
+
+  baseline['cases'].each do |case_name, test_case|
+    runs = options[:repetitions].times.map do
+      command = if test_case['binary'].start_with? 'seq_'
+        [binary[test_case['binary']], '-b', '-s', baseline['seed'].to_s, graphs[test_case['graph']]]
+      else
+        [binary[test_case['binary']], graphs[test_case['graph']]]
+      end
+      measurements parse_log(run(thrill_env.merge('SEED' => baseline['seed'].to_s), *command))
+    end
+    # runtime and memory of the fastest run, quality is deterministic given the seed
+    current = runs.min_by { |it| it['runtime'] || Float::INFINITY }
+
+    puts case_name
+    current.each do |key, value|
+      expected = test_case.dig('baseline', key)
+      tolerance = tolerances[key]
+      skipped = (test_case['skipped'] || []).include?(key) && !options[:update]
+      # a value the binary no longer reports or one without a baseline fails unless the case lists it as skipped,
+      # --update records the baseline
+      verdict = if value.nil?
+        missing << "#{case_name} #{key}: not reported" unless skipped
+        skipped ? 'skipped' : 'MISSING'
+      elsif skipped
+        'skipped'
+      elsif expected.nil?
+        failures << "#{case_name} #{key}: no baseline, record it with --update" unless options[:update]
+        'NO BASELINE'
+      else
+        # runtime and memory relative, quality absolute; higher modularity and lower map equation are better
+        worse_by = case key
+          when 'modularity' then expected - value
+          when 'map_equation' then value - expected
+          else (value - expected) / expected
+        end
+        failures << "#{case_name} #{key}: #{value} vs baseline #{expected}" if worse_by > tolerance
+        worse_by > tolerance ? 'FAIL' : 'ok'
+      end
+      puts '  %-14s %16s %16s  %s' % [key, value.nil? ? '-' : value.round(6), expected.nil? ? '-' : expected.round(6), verdict]
+    end
+
+    if options[:update]
+      test_case['baseline'] = current
+      test_case.delete('skipped')
+    end
+  end
+end
+
+failures = missing + failures
+if options[:update] && missing.empty?
+  File.write options[:baseline], JSON.pretty_generate(baseline) + "\n"
+  puts "baseline written to #{options[:baseline]}"
+elsif failures.empty?
+  puts 'no regressions'
+else
+  puts "#{failures.size} regressions:"
+  failures.each { |failure| puts "  #{failure}" }
+  exit 1
+end
@@ -15,7 +15,7 @@ free -h
 
 result_id=$(ruby -e "require 'securerandom'; puts SecureRandom.uuid")
 export SEED=$(ruby -e "puts rand 2**31 - 1")
-executable="$HOME/code/release/dlslm_with_seq"
+executable="$HOME/code/release/dlslm"
 startexe="$HOME/code/lib/thrill/run/slurm/invoke.sh ${executable}"
-echo $startexe "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
-exec $startexe "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
+echo $startexe -q 16000000 "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
+exec $startexe -q 16000000 "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
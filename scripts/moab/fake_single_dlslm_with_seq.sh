@@ -16,12 +16,12 @@ free -h
 
 result_id=$(ruby -e "require 'securerandom'; puts SecureRandom.uuid")
 export SEED=$(ruby -e "puts rand 2**31 - 1")
-executable="$HOME/code/release/dlslm_with_seq"
-echo $executable "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
+executable="$HOME/code/release/dlslm"
+echo $executable -q 16000000 "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
 exec srun -v \
      --exclusive \
      --ntasks="1" \
      --ntasks-per-node="1" \
      --kill-on-bad-exit \
      --mem=0 \
-     $executable "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
+     $executable -q 16000000 "$GRAPH" "$CLUSTERING-$MOAB_JOBID-@@@@-#####.bin,$result_id"
@@ -2,8 +2,11 @@
 
 #include "data/graph.hpp"
 #include "data/cluster_store.hpp"
+#include "data/ghost_graph.hpp"
+#include "data/ghost_cluster_store.hpp"
 #include "algo/contraction.hpp"
 #include "util/logging.hpp"
+#include "util/phase_stats.hpp"
 #include "algo/modularity.hpp"
 #include "algo/map_eq.hpp"
 
@@ -14,6 +17,7 @@
 #include <cstdint>
 #include <algorithm>
 #include <random>
+#include <numeric>
 
 namespace Louvain {
 
@@ -27,32 +31,67 @@ using Weight = typename Graph::Weight;
 using ClusterId = typename ClusterStore::ClusterId;
 
 template<class GraphType, class ClusterStoreType, typename F>
-void contractAndReapply(const GraphType &, ClusterStoreType &, uint64_t, uint32_t, const F& f);
+void contractAndReapply(const GraphType &, ClusterStoreType &, uint64_t, uint32_t, PhaseStats::LevelRecord, const F& f);
 
+// The drivers reset the peak rss of the process on every level so that each level reports its own peak.
+// Pass nested = true when running inside thrill workers, whose levels reset it once all workers of the host are ready.
 template<class GraphType, class ClusterStoreType>
-void louvainModularity(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level = 0) {
+void louvainModularity(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level = 0, bool nested = false) {
   assert(std::abs(Modularity::modularity(graph, ClusterStore(graph.getNodeCount(), 0))) == 0);
 
+  PhaseStats::LevelRecord level_stats;
+  if (!nested) {
+    Memory::resetPeakRSS();
+  }
+  PhaseStats::Measurement measurement;
   bool changed = Modularity::localMoving(graph, clusters);
+  level_stats.add(PhaseStats::LocalMoving, measurement.stop());
+
+  if (changed) {
+    contractAndReapply(graph, clusters, algo_run_id, level, level_stats, [algo_run_id, nested](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
+      return louvainModularity(meta_graph, meta_clusters, algo_run_id, level, nested);
+    });
+  }
+}
+
+// local moving on all cores, contraction stays sequential
+template<class GraphType, class ClusterStoreType>
+void parallelLouvainModularity(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level = 0, bool nested = false) {
+  PhaseStats::LevelRecord level_stats;
+  if (!nested) {
+    Memory::resetPeakRSS();
+  }
+  PhaseStats::ParallelMeasurement measurement;
+  bool changed = Modularity::parallelLocalMoving(graph, clusters, measurement);
+  level_stats.add(PhaseStats::LocalMoving, measurement.stop());
 
   if (changed) {
-    contractAndReapply(graph, clusters, algo_run_id, level, [algo_run_id](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
-      return louvainModularity(meta_graph, meta_clusters, algo_run_id, level);
+    contractAndReapply(graph, clusters, algo_run_id, level, level_stats, [algo_run_id, nested](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
+      return parallelLouvainModularity(meta_graph, meta_clusters, algo_run_id, level, nested);
     });
   }
 }
 
 template<class GraphType, class ClusterStoreType>
-void louvainMapEq(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level = 0) {
+void louvainMapEq(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level = 0, bool nested = false) {
+  PhaseStats::LevelRecord level_stats;
+  if (!nested) {
+    Memory::resetPeakRSS();
+  }
+  PhaseStats::Measurement measurement;
   bool changed = MapEq::localMoving(graph, clusters);
+  level_stats.add(PhaseStats::LocalMoving, measurement.stop());
 
   if (changed) {
-    contractAndReapply(graph, clusters, algo_run_id, level, [algo_run_id](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
-      return louvainMapEq(meta_graph, meta_clusters, algo_run_id, level);
+    contractAndReapply(graph, clusters, algo_run_id, level, level_stats, [algo_run_id, nested](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
+      return louvainMapEq(meta_graph, meta_clusters, algo_run_id, level, nested);
     });
   }
 }
 
+// Every partition element gets a GhostGraph with compact ids, so its local moving costs are proportional to its size.
+// Without move_to_ghosts links leaving the element are dropped, the degrees stay those of the whole graph.
+// Elements are processed in parallel, each with its own random engine drawn from Modularity::rng.
 template<bool move_to_ghosts = true>
 void partitionedLouvain(const Graph& graph, ClusterStore &clusters, const std::vector<uint32_t>& partitions, uint64_t algo_run_id, const std::vector<Logging::Id>& partition_element_logging_ids) {
   assert(partitions.size() == graph.getNodeCount());
@@ -65,43 +104,88 @@ void partitionedLouvain(const Graph& graph, ClusterStore &clusters, const std::v
     partition_nodes[partitions[node]].push_back(node);
   }
 
-  ClusterId minimum_partition_cluster_id = 0;
-  ClusterStore partition_clustering(graph.getNodeCount());
-  for (uint32_t partition = 0; partition < partition_nodes.size(); partition++) {
-    partition_clustering.resetBounds();
-    Modularity::localMoving<Graph, ClusterStore, move_to_ghosts>(graph, partition_clustering, partition_nodes[partition]);
+  std::vector<std::default_random_engine> partition_rngs;
+  for (uint32_t partition = 0; partition < partition_count; partition++) {
+    partition_rngs.emplace_back(Modularity::rng());
+  }
 
-    if (move_to_ghosts) {
-      uint32_t nodes_in_ghost_clusters = 0;
-      for (const NodeId node : partition_nodes[partition]) {
-        if (partitions[partition_clustering[node]] != partition) {
-          nodes_in_ghost_clusters++;
-        }
+  PhaseStats::LevelRecord level_stats;
+  Memory::resetPeakRSS();
+  PhaseStats::ParallelMeasurement measurement;
+  // cluster ids of each element are compacted to 0.., made unique afterwards
+  std::vector<std::vector<ClusterId>> partition_clusterings(partition_count);
+  std::vector<ClusterId> partition_cluster_counts(partition_count);
+  std::vector<uint32_t> nodes_in_ghost_clusters(partition_count, 0);
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (uint32_t partition = 0; partition < partition_count; partition++) {
+    measurement.startThread();
+    const std::vector<NodeId>& nodes = partition_nodes[partition];
+    GhostGraph<true> partition_graph(nodes.size(), graph.getTotalWeight());
+    partition_graph.initialize<NodeWithWeightedLinks>([&](const auto& emit) {
+      for (const NodeId node : nodes) {
+        NodeWithWeightedLinksAndTargetDegree node_with_links { node, {} };
+        graph.forEachAdjacentNode(node, [&](const NodeId neighbor, const Weight weight) {
+          if (move_to_ghosts || partitions[neighbor] == partition) {
+            node_with_links.push_back(WeightedEdgeTargetWithDegree { neighbor, weight, graph.nodeDegree(neighbor) });
+          }
+        });
+        node_with_links.weighted_degree_cache = graph.nodeDegree(node);
+        emit(std::move(node_with_links));
+      }
+    });
+
+    GhostClusterStore partition_clustering(nodes.size());
+    std::vector<NodeId> nodes_to_move(nodes.size());
+    std::iota(nodes_to_move.begin(), nodes_to_move.end(), 0);
+    Modularity::localMoving(partition_graph, partition_clustering, nodes_to_move, partition_rngs[partition]);
+
+    for (NodeId node = 0; node < nodes.size(); node++) {
+      if (partition_clustering[node] >= nodes.size()) {
+        nodes_in_ghost_clusters[partition]++;
       }
-      Logging::report("partition_element", partition_element_logging_ids[partition], "nodes_in_ghost_clusters", nodes_in_ghost_clusters);
     }
 
-    minimum_partition_cluster_id = partition_clustering.rewriteClusterIds(partition_nodes[partition], minimum_partition_cluster_id);
+    partition_cluster_counts[partition] = partition_clustering.rewriteClusterIds();
+    partition_clusterings[partition].reserve(nodes.size());
+    for (NodeId node = 0; node < nodes.size(); node++) {
+      partition_clusterings[partition].push_back(partition_clustering[node]);
+    }
+    measurement.stopThread();
+  }
+
+  ClusterId minimum_partition_cluster_id = 0;
+  for (uint32_t partition = 0; partition < partition_count; partition++) {
+    for (NodeId node = 0; node < partition_nodes[partition].size(); node++) {
+      clusters.set(partition_nodes[partition][node], minimum_partition_cluster_id + partition_clusterings[partition][node]);
+    }
+    minimum_partition_cluster_id += partition_cluster_counts[partition];
 
-    for (NodeId node : partition_nodes[partition]) {
-      clusters.set(node, partition_clustering[node]);
+    if (move_to_ghosts) {
+      Logging::report("partition_element", partition_element_logging_ids[partition], "nodes_in_ghost_clusters", nodes_in_ghost_clusters[partition]);
     }
   }
 
-  contractAndReapply(graph, clusters, algo_run_id, 0, [algo_run_id](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
+  level_stats.add(PhaseStats::LocalMoving, measurement.stop());
+
+  contractAndReapply(graph, clusters, algo_run_id, 0, level_stats, [algo_run_id](const auto& meta_graph, auto& meta_clusters, uint32_t level) {
     return louvainModularity(meta_graph, meta_clusters, algo_run_id, level);
   });
 }
 
 template<class GraphType, class ClusterStoreType, typename F>
-void contractAndReapply(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level, const F& f) {
+void contractAndReapply(const GraphType& graph, ClusterStoreType &clusters, uint64_t algo_run_id, uint32_t level, PhaseStats::LevelRecord level_stats, const F& f) {
+  PhaseStats::Measurement measurement;
   Graph meta_graph = Contraction::contract(graph, clusters);
+  level_stats.add(PhaseStats::Contraction, measurement.stop());
+  level_stats.notePeakRSS();
 
   uint64_t level_logging_id = Logging::getUnusedId();
   Logging::report("algorithm_level", level_logging_id, "algorithm_run_id", algo_run_id);
   Logging::report("algorithm_level", level_logging_id, "node_count", graph.getNodeCount());
   Logging::report("algorithm_level", level_logging_id, "cluster_count", meta_graph.getNodeCount());
   Logging::report("algorithm_level", level_logging_id, "level", level);
+  level_stats.report("algorithm_level", level_logging_id);
 
   // uint64_t distribution_logging_id = Logging::getUnusedId();
   // Logging::report("cluster_size_distribution", distribution_logging_id, "algorithm_level_id", level_logging_id);
@@ -22,17 +22,79 @@ using EdgeId = typename Graph::EdgeId;
 using Weight = typename Graph::Weight;
 using ClusterId = typename ClusterStore::ClusterId;
 
+// Map equation terms depending on the cluster of u when u (degree deg_u, loop weight loop_u) is moved from clus_u to target_clus.
+// Moving to clus_u itself yields the terms of the current state, so the difference of two calls is the change of the map equation.
+inline double updateCost(const Weight total_vol, const Weight total_inter_vol, const std::vector<Weight>& cluster_cuts, const std::vector<Weight>& cluster_volumes,
+                         const Weight deg_u, const Weight loop_u, const ClusterId clus_u, const ClusterId target_clus, const Weight weight_to_target, const Weight weight_to_orig) {
+  int64_t cut_diff_old = 2 * weight_to_orig - deg_u + loop_u;
+  double values[5];
+  if (clus_u != target_clus) {
+    int64_t cut_diff_new = deg_u - 2 * weight_to_target - loop_u;
+
+    values[0] = static_cast<double>(total_inter_vol + cut_diff_old + cut_diff_new);
+    values[1] = static_cast<double>(cluster_cuts[target_clus] + cut_diff_new);
+    values[2] = static_cast<double>(cluster_cuts[target_clus]);
+    values[3] = static_cast<double>(cluster_cuts[target_clus] + cut_diff_new + cluster_volumes[target_clus] + deg_u);
+    values[4] = static_cast<double>(cluster_cuts[target_clus] + cluster_volumes[target_clus]);
+  } else {
+    values[0] = static_cast<double>(total_inter_vol);
+    values[1] = static_cast<double>(cluster_cuts[clus_u]);
+    values[2] = static_cast<double>(cluster_cuts[clus_u] + cut_diff_old);
+    values[3] = static_cast<double>(cluster_cuts[clus_u] + cluster_volumes[clus_u]);
+    values[4] = static_cast<double>(cluster_cuts[clus_u] + cut_diff_old + cluster_volumes[clus_u] - deg_u);
+  }
+
+  double result[5];
+
+#if MAX_VECTOR_SIZE >= 256
+  double inverse_total_volume = 1. / total_vol;
+  Vec4d value_vec, result_vec;
+  value_vec.load(values);
+  value_vec *= inverse_total_volume;
+  result_vec = select(value_vec > .0, value_vec * log(value_vec), Vec4d(0,0,0,0));
+  result_vec.store(result);
+
+  for (uint8_t i = 4; i < 5; ++i) {
+#else
+#pragma omp simd
+  for (uint8_t i = 0; i < 5; ++i) {
+#endif
+    result[i] = 0;
+    values[i] /= total_vol;
+    if (values[i] > .0) {
+      result[i] = values[i] * log(values[i]);
+    }
+  }
+
+  return result[0] + ((result[3] - result[4]) - (2 * (result[1] - result[2])));
+}
+
+template<class GraphType, class ClusterStoreType>
+bool localMoving(const GraphType& graph, ClusterStoreType &clusters, Weight total_inter_vol);
+
 template<class GraphType, class ClusterStoreType>
 bool localMoving(const GraphType& graph, ClusterStoreType &clusters) {
+  Weight total_inter_vol = 0;
+  graph.forEachEdge([&](NodeId node, NodeId neighbor, Weight weight) {
+    if (neighbor != node) {
+      total_inter_vol += weight;
+    }
+  });
+  return localMoving(graph, clusters, total_inter_vol);
+}
+
+// total_inter_vol is the cut of the singleton clustering of the whole graph, which a GhostGraph only knows a part of.
+// Ghost nodes stay singletons and may be joined, their cut is approximated by their degree as loops of ghosts are unknown.
+template<class GraphType, class ClusterStoreType>
+bool localMoving(const GraphType& graph, ClusterStoreType &clusters, Weight total_inter_vol) {
   std::vector<NodeId> nodes_to_move(graph.getNodeCount());
   std::iota(nodes_to_move.begin(), nodes_to_move.end(), 0);
   bool changed = false;
 
   clusters.assignSingletonClusterIds();
-  std::vector<Weight> cluster_volumes(graph.getNodeCount());
-  std::vector<Weight> cluster_cuts(graph.getNodeCount());
+  std::vector<Weight> cluster_volumes(graph.getNodeCountIncludingGhost());
+  std::vector<Weight> cluster_cuts(graph.getNodeCountIncludingGhost());
   Weight total_vol = graph.getTotalWeight() * 2;
-  Weight total_inter_vol = 0;
 
   for (NodeId node = 0; node < graph.getNodeCount(); node++) {
     cluster_volumes[node] = graph.nodeDegree(node);
@@ -40,10 +102,13 @@ bool localMoving(const GraphType& graph, ClusterStoreType &clusters) {
     graph.forEachAdjacentNode(node, [&](NodeId neighbor, Weight weight) {
       if (neighbor != node) {
         cluster_cuts[node] += weight;
-        total_inter_vol += weight;
       }
     });
   }
+  for (NodeId ghost = graph.getNodeCount(); ghost < graph.getNodeCountIncludingGhost(); ghost++) {
+    cluster_volumes[ghost] = graph.nodeDegree(ghost);
+    cluster_cuts[ghost] = graph.nodeDegree(ghost);
+  }
   std::shuffle(nodes_to_move.begin(), nodes_to_move.end(), rng);
 
 #ifndef NDEBUG
@@ -84,47 +149,7 @@ bool localMoving(const GraphType& graph, ClusterStoreType &clusters) {
 #endif
 
   const auto update_cost = [&](const NodeId, const Weight deg_u, const Weight loop_u, const ClusterId clus_u, const ClusterId target_clus, const Weight weight_to_target, const Weight weight_to_orig) -> double {
-    int64_t cut_diff_old = 2 * weight_to_orig - deg_u + loop_u;
-    double values[5];
-    if (clus_u != target_clus) {
-      int64_t cut_diff_new = deg_u - 2 * weight_to_target - loop_u;
-
-      values[0] = static_cast<double>(total_inter_vol + cut_diff_old + cut_diff_new);
-      values[1] = static_cast<double>(cluster_cuts[target_clus] + cut_diff_new);
-      values[2] = static_cast<double>(cluster_cuts[target_clus]);
-      values[3] = static_cast<double>(cluster_cuts[target_clus] + cut_diff_new + cluster_volumes[target_clus] + deg_u);
-      values[4] = static_cast<double>(cluster_cuts[target_clus] + cluster_volumes[target_clus]);
-    } else {
-      values[0] = static_cast<double>(total_inter_vol);
-      values[1] = static_cast<double>(cluster_cuts[clus_u]);
-      values[2] = static_cast<double>(cluster_cuts[clus_u] + cut_diff_old);
-      values[3] = static_cast<double>(cluster_cuts[clus_u] + cluster_volumes[clus_u]);
-      values[4] = static_cast<double>(cluster_cuts[clus_u] + cut_diff_old + cluster_volumes[clus_u] - deg_u);
-    }
-
-    double result[5];
-
-#if MAX_VECTOR_SIZE >= 256
-    double inverse_total_volume = 1. / total_vol;
-    Vec4d value_vec, result_vec;
-    value_vec.load(values);
-    value_vec *= inverse_total_volume;
-    result_vec = select(value_vec > .0, value_vec * log(value_vec), Vec4d(0,0,0,0));
-    result_vec.store(result);
-
-    for (uint8_t i = 4; i < 5; ++i) {
-#else
-#pragma omp simd
-    for (uint8_t i = 0; i < 5; ++i) {
-#endif
-      result[i] = 0;
-      values[i] /= total_vol;
-      if (values[i] > .0) {
-        result[i] = values[i] * log(values[i]);
-      }
-    }
-
-    return result[0] + ((result[3] - result[4]) - (2 * (result[1] - result[2])));
+    return updateCost(total_vol, total_inter_vol, cluster_cuts, cluster_volumes, deg_u, loop_u, clus_u, target_clus, weight_to_target, weight_to_orig);
   };
 
   const auto move_node = [&](const NodeId u, const Weight deg_u, const Weight loop_u, const ClusterId clus_u, const ClusterId target_clus, const Weight weight_to_target, const Weight weight_to_orig) {
@@ -188,7 +213,7 @@ bool localMoving(const GraphType& graph, ClusterStoreType &clusters) {
       assert(false);
     }
     // assert(loop_u == 0);
-    assert(std::accumulate(cluster_cuts.begin(), cluster_cuts.end(), 0ull) == total_inter_vol);
+    assert(graph.getNodeCountIncludingGhost() > graph.getNodeCount() || std::accumulate(cluster_cuts.begin(), cluster_cuts.end(), 0ull) == total_inter_vol);
 #endif
   };
 
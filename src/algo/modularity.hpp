@@ -4,6 +4,7 @@
 #include "data/cluster_store.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <assert.h>
 #include <cmath>
@@ -90,8 +91,9 @@ int128_t deltaModularity(const GraphType &graph,
 
 template<class GraphType, class ClusterStoreType>
 bool localMoving(const GraphType& graph, ClusterStoreType &clusters);
+// random is the source of the node order, pass an own engine when running concurrently
 template<class GraphType, class ClusterStoreType, bool move_to_ghosts = true>
-bool localMoving(const GraphType& graph, ClusterStoreType &clusters, std::vector<NodeId>& nodes_to_move);
+bool localMoving(const GraphType& graph, ClusterStoreType &clusters, std::vector<NodeId>& nodes_to_move, std::default_random_engine& random = rng);
 
 template<class GraphType, class ClusterStoreType>
 bool localMoving(const GraphType& graph, ClusterStoreType &clusters) {
@@ -101,7 +103,7 @@ bool localMoving(const GraphType& graph, ClusterStoreType &clusters) {
 }
 
 template<class GraphType, class ClusterStoreType, bool move_to_ghosts>
-bool localMoving(const GraphType& graph, ClusterStoreType &clusters, std::vector<NodeId>& nodes_to_move) {
+bool localMoving(const GraphType& graph, ClusterStoreType &clusters, std::vector<NodeId>& nodes_to_move, std::default_random_engine& random) {
   std::vector<bool> included_nodes(move_to_ghosts ? 0 : graph.getNodeCount(), false);
   if (!move_to_ghosts) {
     for (NodeId node : nodes_to_move) {
@@ -119,7 +121,7 @@ bool localMoving(const GraphType& graph, ClusterStoreType &clusters, std::vector
   for (NodeId i = 0; i < graph.getNodeCountIncludingGhost(); i++) {
     cluster_weights[i] = graph.nodeDegree(i);
   }
-  std::shuffle(nodes_to_move.begin(), nodes_to_move.end(), rng);
+  std::shuffle(nodes_to_move.begin(), nodes_to_move.end(), random);
 
   NodeId current_node_index = 0;
   NodeId unchanged_count = 0;
@@ -180,11 +182,126 @@ bool localMoving(const GraphType& graph, ClusterStoreType &clusters, std::vector
     if (current_node_index >= nodes_to_move.size()) {
       current_node_index = 0;
       current_iteration++;
-      std::shuffle(nodes_to_move.begin(), nodes_to_move.end(), rng);
+      std::shuffle(nodes_to_move.begin(), nodes_to_move.end(), random);
     }
   }
 
   return changed;
 }
 
+// Shared memory parallel local moving in the style of PLM: the threads move disjoint nodes of a round
+// concurrently and see each others moves right away. Cluster volumes are updated atomically, a decision
+// may be based on a slightly outdated neighbor cluster or volume, which only affects quality.
+// Ghost nodes of a GhostGraph stay in their singleton clusters but may be joined like in localMoving.
+// thread_stats.startThread() and stopThread() enclose the work of every thread in the parallel regions,
+// see PhaseStats::ParallelMeasurement.
+template<class GraphType, class ClusterStoreType, class ThreadStats>
+bool parallelLocalMoving(const GraphType& graph, ClusterStoreType &clusters, ThreadStats& thread_stats) {
+  const NodeId node_count = graph.getNodeCount();
+  const NodeId node_count_including_ghost = graph.getNodeCountIncludingGhost();
+  const int128_t total_weight = graph.getTotalWeight();
+
+  std::vector<std::atomic<ClusterId>> node_clusters(node_count_including_ghost);
+  std::vector<std::atomic<Weight>> cluster_weights(node_count_including_ghost);
+  #pragma omp parallel
+  {
+    thread_stats.startThread();
+    #pragma omp for
+    for (NodeId node = 0; node < node_count_including_ghost; node++) {
+      node_clusters[node].store(node, std::memory_order_relaxed);
+      cluster_weights[node].store(graph.nodeDegree(node), std::memory_order_relaxed);
+    }
+    thread_stats.stopThread();
+  }
+
+  std::vector<NodeId> nodes_to_move(node_count);
+  std::iota(nodes_to_move.begin(), nodes_to_move.end(), 0);
+  std::shuffle(nodes_to_move.begin(), nodes_to_move.end(), rng);
+
+  bool changed = false;
+  bool done = false;
+  NodeId moved = 0;
+
+  #pragma omp parallel
+  {
+    thread_stats.startThread();
+    std::vector<Weight> node_to_cluster_weights(node_count_including_ghost, 0);
+    std::vector<ClusterId> incident_clusters;
+
+    for (int current_iteration = 0; current_iteration < 32 && !done; current_iteration++) {
+      #pragma omp for schedule(guided) reduction(+:moved)
+      for (NodeId i = 0; i < node_count; i++) {
+        const NodeId current_node = nodes_to_move[i];
+        const ClusterId current_node_cluster = node_clusters[current_node].load(std::memory_order_relaxed);
+        const Weight current_node_degree = graph.nodeDegree(current_node);
+        Weight weight_between_node_and_current_cluster = 0;
+
+        graph.forEachAdjacentNode(current_node, [&](NodeId neighbor, Weight weight) {
+          if (neighbor != current_node) {
+            ClusterId neighbor_cluster = node_clusters[neighbor].load(std::memory_order_relaxed);
+            if (neighbor_cluster != current_node_cluster) {
+              if (node_to_cluster_weights[neighbor_cluster] == 0) {
+                incident_clusters.push_back(neighbor_cluster);
+              }
+              node_to_cluster_weights[neighbor_cluster] += weight;
+            } else {
+              weight_between_node_and_current_cluster += weight;
+            }
+          }
+        });
+
+        // same as deltaModularity, which needs a plain vector of cluster weights
+        const int128_t current_cluster_incident_edges_weight = int128_t(cluster_weights[current_node_cluster].load(std::memory_order_relaxed)) - current_node_degree;
+        ClusterId best_cluster = current_node_cluster;
+        int128_t best_delta_modularity = 0;
+        for (ClusterId incident_cluster : incident_clusters) {
+          int128_t e = total_weight * int128_t(2) * (int128_t(node_to_cluster_weights[incident_cluster]) - weight_between_node_and_current_cluster);
+          int128_t a = (int128_t(cluster_weights[incident_cluster].load(std::memory_order_relaxed)) - current_cluster_incident_edges_weight) * int128_t(current_node_degree);
+          if (e - a > best_delta_modularity) {
+            best_delta_modularity = e - a;
+            best_cluster = incident_cluster;
+          }
+
+          node_to_cluster_weights[incident_cluster] = 0;
+        }
+
+        incident_clusters.clear();
+
+        if (best_cluster != current_node_cluster) {
+          cluster_weights[current_node_cluster].fetch_sub(current_node_degree, std::memory_order_relaxed);
+          cluster_weights[best_cluster].fetch_add(current_node_degree, std::memory_order_relaxed);
+          node_clusters[current_node].store(best_cluster, std::memory_order_relaxed);
+          moved++;
+        }
+      }
+
+      #pragma omp single
+      {
+        changed = changed || moved > 0;
+        done = moved == 0;
+        moved = 0;
+      }
+    }
+    thread_stats.stopThread();
+  }
+
+  clusters.assignSingletonClusterIds();
+  for (NodeId node = 0; node < node_count; node++) {
+    clusters.set(node, node_clusters[node].load(std::memory_order_relaxed));
+  }
+
+  return changed;
+}
+
+struct NoThreadStats {
+  void startThread() {}
+  void stopThread() {}
+};
+
+template<class GraphType, class ClusterStoreType>
+bool parallelLocalMoving(const GraphType& graph, ClusterStoreType &clusters) {
+  NoThreadStats no_thread_stats;
+  return parallelLocalMoving(graph, clusters, no_thread_stats);
+}
+
 }
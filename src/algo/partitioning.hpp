@@ -5,9 +5,14 @@
 #include "util/logging.hpp"
 
 #include <assert.h>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
 #include <limits>
 #include <algorithm>
+#include <numeric>
+#include <string>
+#include <omp.h>
 
 namespace Partitioning {
 
@@ -24,51 +29,150 @@ NodeId partitionElementTargetSize(const Graph& graph, const uint32_t partition_s
   return partitionElementTargetSize(graph.getNodeCount(), partition_size);
 }
 
-Logging::Id deterministicGreedyWithLinearPenalty(const Graph& graph, const uint32_t partition_size, std::vector<PartitionElementId>& node_partition_elements, bool shuffled = false) {
+// Objectives for streaming(): the value of putting a node into an element given the weight of its
+// links into it and the current element size. Elements never grow beyond capacity.
+struct LinearDeterministicGreedy {
+  NodeId capacity;
+
+  LinearDeterministicGreedy(const Graph& graph, const uint32_t partition_size) :
+    capacity(partitionElementTargetSize(graph, partition_size)) {}
+
+  double value(const Weight neighbor_weight, const NodeId element_size) const {
+    return neighbor_weight * (1. - double(element_size) / capacity);
+  }
+
+  const char* name() const { return "deterministic_greedy_with_linear_penalty"; }
+};
+
+// Tsourakakis et al. 2014, neighbors minus a marginal cost growing with the element size
+struct Fennel {
+  static constexpr double gamma = 1.5;
+  static constexpr double slack = 1.1;
+  double alpha;
+  NodeId capacity;
+
+  Fennel(const Graph& graph, const uint32_t partition_size) :
+    alpha(std::sqrt(partition_size) * graph.getEdgeCount() / std::pow(graph.getNodeCount(), gamma)),
+    capacity(std::ceil(slack * partitionElementTargetSize(graph, partition_size))) {}
+
+  double value(const Weight neighbor_weight, const NodeId element_size) const {
+    return neighbor_weight - alpha * gamma * std::pow(element_size, gamma - 1);
+  }
+
+  const char* name() const { return "fennel"; }
+};
+
+// One pass over the nodes, each one goes to the best element among those of its already assigned neighbors
+// and one fallback element, which cycles over all elements and catches nodes without assigned neighbors.
+// So every node costs O(degree) instead of O(partition_size).
+// Buffers of consecutive stream positions are processed by multiple threads, which see each others
+// assignments as they happen. Results only depend on the seed when running with a single thread.
+template<class Objective>
+Logging::Id streaming(const Graph& graph, const uint32_t partition_size, std::vector<PartitionElementId>& node_partition_elements, const Objective& objective, bool shuffled = false) {
   assert(graph.getNodeCount() == node_partition_elements.size());
-  NodeId partition_target_size = partitionElementTargetSize(graph, partition_size);
+  assert(uint64_t(objective.capacity) * partition_size >= graph.getNodeCount());
+  constexpr NodeId buffer_size = 4096;
+  const PartitionElementId unassigned = partition_size;
 
-  std::vector<NodeId> partition_sizes(partition_size, 0);
-  std::vector<NodeId> neighbor_partition_intersection_sizes(partition_size, 0);
-  std::vector<PartitionElementId> partition_elements(partition_size);
-  std::iota(partition_elements.begin(), partition_elements.end(), 0);
+  std::vector<std::atomic<PartitionElementId>> assignments(graph.getNodeCount());
+  for (auto& assignment : assignments) {
+    assignment.store(unassigned, std::memory_order_relaxed);
+  }
+  std::vector<std::atomic<NodeId>> element_sizes(partition_size);
+  for (auto& size : element_sizes) {
+    size.store(0, std::memory_order_relaxed);
+  }
 
   std::vector<NodeId> node_ids(graph.getNodeCount());
   std::iota(node_ids.begin(), node_ids.end(), 0);
   if (shuffled) {
     std::shuffle(node_ids.begin(), node_ids.end(), Modularity::rng);
   }
+  const NodeId buffer_count = (graph.getNodeCount() + buffer_size - 1) / buffer_size;
+  int threads = 1;
+
+  #pragma omp parallel
+  {
+    #pragma omp single
+    threads = omp_get_num_threads();
+
+    std::vector<Weight> neighbor_weights(partition_size, 0);
+    std::vector<PartitionElementId> neighbor_elements;
+    PartitionElementId fallback = omp_get_thread_num() % partition_size;
+
+    #pragma omp for schedule(dynamic, 1)
+    for (NodeId buffer = 0; buffer < buffer_count; buffer++) {
+      const NodeId buffer_end = std::min(graph.getNodeCount(), (buffer + 1) * buffer_size);
+      for (NodeId index = buffer * buffer_size; index < buffer_end; index++) {
+        const NodeId node = node_ids[index];
+        graph.forEachAdjacentNode(node, [&](const NodeId neighbor, const Weight weight) {
+          const PartitionElementId element = assignments[neighbor].load(std::memory_order_relaxed);
+          if (element != unassigned) {
+            if (neighbor_weights[element] == 0) {
+              neighbor_elements.push_back(element);
+            }
+            neighbor_weights[element] += weight;
+          }
+        });
 
-  for (NodeId node : node_ids) {
-    graph.forEachAdjacentNode(node, [&](NodeId neighbor, Weight) {
-      if (neighbor < node) {
-        neighbor_partition_intersection_sizes[node_partition_elements[neighbor]]++;
-      }
-    });
+        while (true) {
+          while (element_sizes[fallback].load(std::memory_order_relaxed) >= objective.capacity) {
+            fallback = (fallback + 1) % partition_size;
+          }
 
-    std::shuffle(partition_elements.begin(), partition_elements.end(), Modularity::rng);
-    double best_partition_value = -std::numeric_limits<double>::max();
-    PartitionElementId best_partition = partition_size;
-    for (PartitionElementId partition : partition_elements) {
-      double value = (1. - (double(partition_sizes[partition]) / partition_target_size)) * neighbor_partition_intersection_sizes[partition];
+          PartitionElementId best_element = fallback;
+          NodeId best_element_size = element_sizes[fallback].load(std::memory_order_relaxed);
+          double best_value = objective.value(neighbor_weights[fallback], best_element_size);
+          for (const PartitionElementId element : neighbor_elements) {
+            const NodeId element_size = element_sizes[element].load(std::memory_order_relaxed);
+            if (element_size >= objective.capacity) {
+              continue;
+            }
+            const double value = objective.value(neighbor_weights[element], element_size);
+            if (value > best_value || (value == best_value && element_size < best_element_size)) {
+              best_element = element;
+              best_element_size = element_size;
+              best_value = value;
+            }
+          }
 
-      if (value > best_partition_value) {
-        best_partition_value = value;
-        best_partition = partition;
-      }
+          // another thread may have filled the element in the meantime
+          if (element_sizes[best_element].fetch_add(1, std::memory_order_relaxed) < objective.capacity) {
+            assignments[node].store(best_element, std::memory_order_relaxed);
+            break;
+          }
+          element_sizes[best_element].fetch_sub(1, std::memory_order_relaxed);
+        }
 
-      neighbor_partition_intersection_sizes[partition] = 0;
+        if (assignments[node].load(std::memory_order_relaxed) == fallback) {
+          fallback = (fallback + 1) % partition_size;
+        }
+        for (const PartitionElementId element : neighbor_elements) {
+          neighbor_weights[element] = 0;
+        }
+        neighbor_elements.clear();
+      }
     }
+  }
 
-    node_partition_elements[node] = best_partition;
-    partition_sizes[best_partition]++;
+  for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+    node_partition_elements[node] = assignments[node].load(std::memory_order_relaxed);
   }
 
   Logging::Id partition_logging_id = Logging::getUnusedId();
-  Logging::report("partition", partition_logging_id, "algorithm", shuffled ? "random_order_deterministic_greedy_with_linear_penalty" : "deterministic_greedy_with_linear_penalty");
+  Logging::report("partition", partition_logging_id, "algorithm", shuffled ? std::string("random_order_") + objective.name() : std::string(objective.name()));
+  Logging::report("partition", partition_logging_id, "threads", threads);
   return partition_logging_id;
 }
 
+Logging::Id deterministicGreedyWithLinearPenalty(const Graph& graph, const uint32_t partition_size, std::vector<PartitionElementId>& node_partition_elements, bool shuffled = false) {
+  return streaming(graph, partition_size, node_partition_elements, LinearDeterministicGreedy(graph, partition_size), shuffled);
+}
+
+Logging::Id fennel(const Graph& graph, const uint32_t partition_size, std::vector<PartitionElementId>& node_partition_elements, bool shuffled = false) {
+  return streaming(graph, partition_size, node_partition_elements, Fennel(graph, partition_size), shuffled);
+}
+
 Logging::Id chunk(const Graph& graph, const uint32_t partition_size, std::vector<PartitionElementId>& node_partition_elements) {
   assert(graph.getNodeCount() == node_partition_elements.size());
   NodeId partition_target_size = partitionElementTargetSize(graph, partition_size);
@@ -153,79 +257,117 @@ Logging::Id clusteringBased(const Graph& graph, const uint32_t partition_size, s
   return partition_logging_id;
 }
 
+// Statistics of one partition element: ghosts are the nodes outside adjacent to it,
+// components are the connected components of the subgraph induced by the element.
+struct PartitionElementStats {
+  NodeId node_count;
+  NodeId ghost_count;
+  NodeId component_count;
+};
+
 template<class LoggingId>
-std::vector<Logging::Id> analyse(const Graph& graph, const std::vector<uint32_t>& node_partition_elements, const LoggingId partition_logging_id) {
-  const uint32_t partition_size = *std::max_element(node_partition_elements.begin(), node_partition_elements.end()) + 1;
-  std::vector<Logging::Id> partition_element_logging_ids(partition_size);
-  // CUT SIZE
-  Weight cut_weight = 0;
-  graph.forEachEdge([&](NodeId from, NodeId to, Weight weight) {
-    if (node_partition_elements[from] != node_partition_elements[to]) {
-      cut_weight += weight;
-    }
-  });
-  cut_weight /= 2;
+std::vector<Logging::Id> reportPartitionStats(const Weight cut_weight, const std::vector<PartitionElementStats>& element_stats, const LoggingId partition_logging_id) {
   Logging::report("partition", partition_logging_id, "cut_weight", cut_weight);
-  Logging::report("partition", partition_logging_id, "size", partition_size);
+  Logging::report("partition", partition_logging_id, "size", element_stats.size());
 
-  // CONNECTED COMPONENT
-  std::vector<std::vector<uint32_t>> connect_component_sizes(partition_size);
-  std::vector<bool> reached_nodes(graph.getNodeCount(), false);
+  std::vector<Logging::Id> partition_element_logging_ids(element_stats.size());
+  for (PartitionElementId partition_element = 0; partition_element < element_stats.size(); partition_element++) {
+    Logging::Id element_logging_id = Logging::getUnusedId();
+    partition_element_logging_ids[partition_element] = element_logging_id;
+    Logging::report("partition_element", element_logging_id, "partition_id", partition_logging_id);
+    Logging::report("partition_element", element_logging_id, "node_count", element_stats[partition_element].node_count);
+    Logging::report("partition_element", element_logging_id, "ghost_count", element_stats[partition_element].ghost_count);
+    Logging::report("partition_element", element_logging_id, "connected_components", element_stats[partition_element].component_count);
+  }
 
-  for (NodeId node = 0; node < graph.getNodeCount(); node++) {
-    if (!reached_nodes[node]) {
-      reached_nodes[node] = true;
-      uint32_t component_size = 1;
-
-      std::vector<NodeId> queue;
-      queue.push_back(node);
-      while (!queue.empty()) {
-        NodeId current_node = queue.back();
-        queue.pop_back();
-        graph.forEachAdjacentNode(current_node, [&](const NodeId neighbor, Weight) {
-          if (node_partition_elements[neighbor] == node_partition_elements[node] && !reached_nodes[neighbor]) {
-            component_size += 1; // TODO bug?
-            reached_nodes[neighbor] = true;
-            queue.push_back(neighbor);
-          }
-        });
-      }
+  return partition_element_logging_ids;
+}
 
-      connect_component_sizes[node_partition_elements[node]].push_back(component_size);
+// Root of node in a union find forest whose links always point to smaller ids, halves paths on the way.
+// Safe to call concurrently with unite.
+NodeId findComponent(std::vector<std::atomic<NodeId>>& parents, NodeId node) {
+  while (true) {
+    NodeId parent = parents[node].load(std::memory_order_relaxed);
+    if (parent == node) {
+      return node;
     }
+    NodeId grand_parent = parents[parent].load(std::memory_order_relaxed);
+    parents[node].compare_exchange_weak(parent, grand_parent, std::memory_order_relaxed);
+    node = grand_parent;
   }
+}
 
-  // GHOST COUNT
-  std::vector<uint32_t> ghost_vertex_counts(partition_size, 0);
-  std::vector<bool> reachable_from_partition(partition_size, false);
-
-  for (NodeId node = 0; node < graph.getNodeCount(); node++) {
-    graph.forEachAdjacentNode(node, [&](NodeId neighbor, Weight) {
-      if (node_partition_elements[neighbor] != node_partition_elements[node] && !reachable_from_partition[node_partition_elements[neighbor]]) {
-        reachable_from_partition[node_partition_elements[neighbor]] = true;
-        ghost_vertex_counts[node_partition_elements[neighbor]] += 1;
-      }
-    });
-    reachable_from_partition.assign(reachable_from_partition.size(), false);
+void uniteComponents(std::vector<std::atomic<NodeId>>& parents, NodeId a, NodeId b) {
+  while (true) {
+    a = findComponent(parents, a);
+    b = findComponent(parents, b);
+    if (a == b) {
+      return;
+    }
+    if (a < b) {
+      std::swap(a, b);
+    }
+    NodeId expected = a;
+    if (parents[a].compare_exchange_weak(expected, b, std::memory_order_relaxed)) {
+      return;
+    }
   }
+}
 
-  // COUNT
-  std::vector<uint32_t> node_counts(partition_size, 0);
+// One parallel pass over all links yields cut, sizes, ghosts and the component forest, a second one over the nodes counts components.
+// Per node work does not depend on the number of elements.
+template<class LoggingId>
+std::vector<Logging::Id> analyse(const Graph& graph, const std::vector<uint32_t>& node_partition_elements, const LoggingId partition_logging_id) {
+  const uint32_t partition_size = *std::max_element(node_partition_elements.begin(), node_partition_elements.end()) + 1;
+  std::vector<PartitionElementStats> element_stats(partition_size, PartitionElementStats { 0, 0, 0 });
+  Weight cut_weight = 0;
+
+  std::vector<std::atomic<NodeId>> parents(graph.getNodeCount());
   for (NodeId node = 0; node < graph.getNodeCount(); node++) {
-    node_counts[node_partition_elements[node]]++;
+    parents[node].store(node, std::memory_order_relaxed);
   }
 
-  // LOG
-  for (PartitionElementId partition_element = 0; partition_element < partition_size; partition_element++) {
-    Logging::Id element_logging_id = Logging::getUnusedId();
-    partition_element_logging_ids[partition_element] = element_logging_id;
-    Logging::report("partition_element", element_logging_id, "partition_id", partition_logging_id);
-    Logging::report("partition_element", element_logging_id, "node_count", node_counts[partition_element]);
-    Logging::report("partition_element", element_logging_id, "ghost_count", ghost_vertex_counts[partition_element]);
-    // Logging::report("partition_element", element_logging_id, "connected_components", connect_component_sizes[partition_element]);
+  #pragma omp parallel reduction(+:cut_weight)
+  {
+    std::vector<PartitionElementStats> thread_stats(partition_size, PartitionElementStats { 0, 0, 0 });
+    // last node which was counted as ghost of each element, avoids clearing a partition_size array per node
+    std::vector<NodeId> ghost_of(partition_size, graph.getNodeCount());
+
+    #pragma omp for schedule(dynamic, 1024)
+    for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+      const uint32_t element = node_partition_elements[node];
+      thread_stats[element].node_count++;
+
+      graph.forEachAdjacentNode(node, [&](const NodeId neighbor, const Weight weight) {
+        const uint32_t neighbor_element = node_partition_elements[neighbor];
+        if (neighbor_element != element) {
+          cut_weight += weight;
+          if (ghost_of[neighbor_element] != node) {
+            ghost_of[neighbor_element] = node;
+            thread_stats[neighbor_element].ghost_count++;
+          }
+        } else if (neighbor < node) {
+          uniteComponents(parents, node, neighbor);
+        }
+      });
+    }
+
+    #pragma omp for schedule(static)
+    for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+      if (findComponent(parents, node) == node) {
+        thread_stats[node_partition_elements[node]].component_count++;
+      }
+    }
+
+    #pragma omp critical
+    for (uint32_t partition_element = 0; partition_element < partition_size; partition_element++) {
+      element_stats[partition_element].node_count += thread_stats[partition_element].node_count;
+      element_stats[partition_element].ghost_count += thread_stats[partition_element].ghost_count;
+      element_stats[partition_element].component_count += thread_stats[partition_element].component_count;
+    }
   }
 
-  return partition_element_logging_ids;
+  return reportPartitionStats(cut_weight / 2, element_stats, partition_logging_id);
 }
 
 }
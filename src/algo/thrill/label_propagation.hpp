@@ -0,0 +1,23 @@
+#pragma once
+
+#include <thrill/api/zip.hpp>
+
+#include "algo/thrill/partitioning.hpp"
+#include "data/thrill/graph.hpp"
+
+namespace LocalMoving {
+
+// Size unconstrained label propagation as a cheap replacement for the local moving of a louvain level.
+// With no_contraction the labels of the first level are the result.
+template<class NodeType>
+auto labelPropagation(const DiaNodeGraph<NodeType>& graph, const uint32_t max_iterations, const bool no_contraction) {
+  auto node_clusters = label_propagation(graph, max_iterations, 0)
+    .Zip(graph.nodes.Keep(), [](const NodeIdLabel& node_label, const NodeType& node) {
+      assert(node_label.node == node.id);
+      return std::pair<NodeType, ClusterId>(node, node_label.label);
+    });
+
+  return std::make_pair(node_clusters, no_contraction);
+}
+
+} // LocalMoving
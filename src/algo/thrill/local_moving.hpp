@@ -2,7 +2,9 @@
 
 #include <thrill/api/cache.hpp>
 #include <thrill/api/collect_local.hpp>
+#include <thrill/api/distribute.hpp>
 #include <thrill/api/fold_by_key.hpp>
+#include <thrill/api/gather.hpp>
 #include <thrill/api/group_by_key.hpp>
 #include <thrill/api/group_to_index.hpp>
 #include <thrill/api/inner_join.hpp>
@@ -10,14 +12,19 @@
 #include <thrill/api/reduce_to_index.hpp>
 #include <thrill/api/reduce_to_index_without_precombine.hpp>
 #include <thrill/api/size.hpp>
+#include <thrill/api/sum.hpp>
 #include <thrill/api/zip.hpp>
 
 #include <vector>
 #include <algorithm>
+#include <omp.h>
 #include <sparsepp/spp.h>
 
 #include "util/util.hpp"
+#include "util/phase_stats.hpp"
+#include "util/worker_threads.hpp"
 #include "data/thrill/graph.hpp"
+#include "algo/thrill/local_moving_config.hpp"
 #include "data/local_dia_graph.hpp"
 #include "algo/thrill/partitioning.hpp"
 
@@ -48,44 +55,37 @@ int128_t deltaModularity(const Weight node_degree, const IncidentClusterInfo& ne
   return e - a;
 }
 
-bool nodeIncluded(const NodeId node, const uint32_t iteration, const uint32_t rate, const uint32_t seed) {
-  #if defined(FIXED_RATIO)
-    uint32_t hash = Util::combined_hash(node, iteration / FIXED_RATIO, seed);
-    return hash % FIXED_RATIO == iteration % FIXED_RATIO;
-  #else
-    uint32_t hash = Util::combined_hash(node, iteration, seed);
-    return hash % 1000 < rate;
-  #endif
-}
-
 static_assert(sizeof(EdgeTargetWithDegree) == 8, "Too big");
 
 template<class NodeType>
-auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_iterations, const uint32_t seed, Logging::Id level_logging_id) {
-  #if defined(SWITCH_TO_SEQ)
-    if (graph.node_count < 1000000) {
-      auto local_nodes = graph.nodes.Gather();
-      std::vector<ClusterId> local_result(local_nodes.size());
-
-      if (graph.nodes.context().my_rank() == 0) {
-        Logging::Id seq_algo_logging_id = Logging::getUnusedId();
-        Logging::report("algorithm_run", seq_algo_logging_id, "distributed_algorithm_run_id", level_logging_id);
-        Logging::report("algorithm_run", seq_algo_logging_id, "algorithm", "sequential louvain");
-        LocalDiaGraph<NodeType> local_graph(local_nodes, graph.total_weight);
-        ClusterStore clusters(graph.node_count);
-        Louvain::louvainModularity(local_graph, clusters, seq_algo_logging_id);
-
-        for (NodeId node = 0; node < graph.node_count; node++) {
-          local_result[node] = clusters[node];
-        }
+auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, const Config& config, const uint32_t seed, Logging::Id level_logging_id) {
+  if (config.switch_to_seq_edge_count > 0 &&
+      graph.nodes.Keep().Map([](const NodeType& node) { return node.links.size(); }).Sum() / 2 < config.switch_to_seq_edge_count) {
+    auto local_nodes = graph.nodes.Gather();
+    std::vector<ClusterId> local_result(local_nodes.size());
+
+    if (graph.nodes.context().my_rank() == 0) {
+      Logging::Id seq_algo_logging_id = Logging::getUnusedId();
+      Logging::report("algorithm_run", seq_algo_logging_id, "distributed_algorithm_run_id", level_logging_id);
+      Logging::report("algorithm_run", seq_algo_logging_id, "algorithm", "shared memory parallel louvain");
+      Logging::report("algorithm_run", seq_algo_logging_id, "threads", omp_get_num_procs());
+      LocalDiaGraph<NodeType> local_graph(local_nodes, graph.total_weight);
+      ClusterStore clusters(graph.node_count);
+      // the other workers of this host idle meanwhile
+      omp_set_num_threads(omp_get_num_procs());
+      Louvain::parallelLouvainModularity(local_graph, clusters, seq_algo_logging_id, 0, /* nested */ true);
+      WorkerThreads::configure();
+
+      for (NodeId node = 0; node < graph.node_count; node++) {
+        local_result[node] = clusters[node];
       }
+    }
 
-      auto nodes = thrill::api::Distribute(graph.nodes.context(), local_nodes);
-      auto clusters = thrill::api::Distribute(graph.nodes.context(), local_result);
+    auto nodes = thrill::api::Distribute(graph.nodes.context(), local_nodes);
+    auto clusters = thrill::api::Distribute(graph.nodes.context(), local_result);
 
-      return std::make_pair(nodes.Zip(clusters, [](const NodeType& node, const ClusterId& cluster) { return std::make_pair(node, cluster); }).Collapse(), true);
-    }
-  #endif
+    return std::make_pair(nodes.Zip(clusters, [](const NodeType& node, const ClusterId& cluster) { return std::make_pair(node, cluster); }).Collapse(), true);
+  }
 
   thrill::common::Range id_range = thrill::common::CalculateLocalRange(graph.node_count, graph.nodes.context().num_workers(), graph.nodes.context().my_rank());
   std::vector<Weight> node_degrees;
@@ -95,12 +95,14 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
 
   auto reduceToBestCluster = [&graph, &id_range, &node_degrees](const auto& incoming) {
     return incoming
+      .Map([](const IncidentClusterInfo& lme) { PhaseStats::count(PhaseStats::EmittedRecords); return lme; })
       // Reduce to best cluster
       .ReduceToIndexWithoutPrecombine(
         [](const IncidentClusterInfo& lme) -> size_t { return lme.node_id; },
         [total_weight = graph.total_weight, &id_range, &node_degrees](const IncidentClusterInfo& lme1, const IncidentClusterInfo& lme2) {
           assert(lme1.node_id >= id_range.begin && lme1.node_id < id_range.end);
           assert(lme2.node_id >= id_range.begin && lme2.node_id < id_range.end);
+          PhaseStats::count(PhaseStats::CandidateClusters);
 
           int128_t d1 = deltaModularity(node_degrees[lme2.node_id - id_range.begin], lme1, total_weight);
           int128_t d2 = deltaModularity(node_degrees[lme2.node_id - id_range.begin], lme2, total_weight);
@@ -120,24 +122,18 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
     .Map([](const NodeType& node) { return std::make_pair(std::make_pair(node, node.id), false); })
     .Collapse();
 
-  #if !defined(STOP_MOVECOUNT)
-    size_t cluster_count = graph.node_count;
-  #endif
-
-  #if defined(FIXED_RATIO)
-    uint32_t rate = 1000 / FIXED_RATIO;
-  #else
-    uint32_t rate = 200;
-  #endif
+  size_t cluster_count = graph.node_count;
+  uint32_t rate = config.initialRate();
   uint32_t rate_sum = 0;
 
   uint32_t iteration;
-  for (iteration = 0; iteration < num_iterations; iteration++) {
-    auto included = [iteration, rate, seed](const NodeId id) { return nodeIncluded(id, iteration, rate, seed); };
+  for (iteration = 0; iteration < config.maxIterations(); iteration++) {
+    auto included = [&config, iteration, rate, seed](const NodeId id) { return config.nodeIncluded(id, iteration, rate, seed); };
 
     size_t considered_nodes_estimate = graph.node_count * rate / 1000;
 
     if (considered_nodes_estimate > 0) {
+      PhaseStats::Scope label_exchange_scope(PhaseStats::LabelExchange);
       node_clusters = (iteration == 0 ?
         reduceToBestCluster(node_clusters
           .template FlatMap<IncidentClusterInfo>(
@@ -200,22 +196,31 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
                   });
                 }
               } else {
-                spp::sparse_hash_map<NodeId, Weight> node_cluster_links;
+                // large clusters are split into node ranges over the worker threads, summed up by link target
+                size_t link_count = 0;
                 for (const NodeType& node : cluster_nodes.second) {
-                  for (const typename NodeType::LinkType& link : node.links) {
-                    if (node.id != link.target && included(link.target)) {
-                      node_cluster_links[link.target] += link.getWeight();
-                    }
-                  }
+                  link_count += node.links.size();
                 }
+                const uint32_t shards = WorkerThreads::shardsFor(link_count);
+                std::vector<spp::sparse_hash_map<NodeId, Weight>> node_cluster_links = WorkerThreads::sumByKey<spp::sparse_hash_map<NodeId, Weight>>(
+                  cluster_nodes.second, shards,
+                  [](const NodeType& node) { return node.links.size(); },
+                  [&included](const NodeType& node, const auto& emit) {
+                    for (const typename NodeType::LinkType& link : node.links) {
+                      if (node.id != link.target && included(link.target)) {
+                        emit(link.target, link.getWeight());
+                      }
+                    }
+                  });
 
                 for (const NodeType& node : cluster_nodes.second) {
                   if (included(node.id)) {
                     Weight node_cluster_link_weight = 0;
-                    auto it = node_cluster_links.find(node.id);
-                    if (it != node_cluster_links.end()) {
+                    auto& shard_links = node_cluster_links[node.id % shards];
+                    auto it = shard_links.find(node.id);
+                    if (it != shard_links.end()) {
                       node_cluster_link_weight = it->second;
-                      node_cluster_links.erase(it);
+                      shard_links.erase(it);
                     }
                     emit(IncidentClusterInfo {
                       node.id,
@@ -226,13 +231,15 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
                   }
                 }
 
-                for (const auto& node_cluster_link : node_cluster_links) {
-                  emit(IncidentClusterInfo {
-                    node_cluster_link.first,
-                    cluster_nodes.first,
-                    node_cluster_link.second,
-                    total_weight
-                  });
+                for (const auto& shard_links : node_cluster_links) {
+                  for (const auto& node_cluster_link : shard_links) {
+                    emit(IncidentClusterInfo {
+                      node_cluster_link.first,
+                      cluster_nodes.first,
+                      node_cluster_link.second,
+                      total_weight
+                    });
+                  }
                 }
               }
             }))
@@ -241,27 +248,33 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
           [&included](const IncidentClusterInfo& lme, const std::pair<std::pair<NodeType, ClusterId>, bool>& old_node_cluster) {
             if (included(old_node_cluster.first.first.id)) {
               assert(lme.node_id == old_node_cluster.first.first.id);
+              if (lme.cluster != old_node_cluster.first.second) {
+                PhaseStats::count(PhaseStats::Moves);
+              }
               return std::make_pair(std::make_pair(old_node_cluster.first.first, lme.cluster), lme.cluster != old_node_cluster.first.second);
             } else {
               return std::make_pair(old_node_cluster.first, false);
             }
           })
         .Cache();
+      // the DIA operations above are lazy, run them while the label exchange is timed
+      node_clusters.Execute();
 
       rate_sum += rate;
-      #if !defined(FIXED_RATIO) || defined(STOP_MOVECOUNT)
-      size_t moved = node_clusters.Keep().Filter([&included](const std::pair<std::pair<NodeType, ClusterId>, bool>& pair) { return pair.second && included(pair.first.first.id); }).Size();
-      #endif
-      #if !defined(FIXED_RATIO)
+      size_t moved = 0;
+      if (config.node_ratio == 0 || !config.stop_on_cluster_count) {
+        moved = node_clusters.Keep().Filter([&included](const std::pair<std::pair<NodeType, ClusterId>, bool>& pair) { return pair.second && included(pair.first.first.id); }).Size();
+      }
+      if (config.node_ratio == 0) {
         rate = std::max(1000 - (moved * 1000 / considered_nodes_estimate), 200ul);
-      #endif
+      }
 
       if (rate_sum >= 1000) {
-        #if defined(STOP_MOVECOUNT)
+        if (!config.stop_on_cluster_count) {
           if (moved <= graph.node_count / 50) {
             break;
           }
-        #else
+        } else {
           size_t round_cluster_count = node_clusters.Keep().Map([](const std::pair<std::pair<NodeType, ClusterId>, bool>& node_cluster) { return node_cluster.first.second; }).Uniq().Size();
           assert(graph.node_count == node_clusters.Size());
 
@@ -270,14 +283,12 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
           }
 
           cluster_count = round_cluster_count;
-        #endif
+        }
         rate_sum -= 1000;
       }
-    } else {
-      #if !defined(FIXED_RATIO)
-        rate += 200;
-        if (rate > 1000) { rate = 1000; }
-      #endif
+    } else if (config.node_ratio == 0) {
+      rate += 200;
+      if (rate > 1000) { rate = 1000; }
     }
   }
   if (node_clusters.context().my_rank() == 0) {
@@ -289,18 +300,21 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
       [](const std::pair<std::pair<NodeType, ClusterId>, bool>& node_cluster) {
         return node_cluster.first;
       }).Collapse(),
-    #if defined(NO_CONTRACTION)
-      true);
-    #else
-      false);
-    #endif
+    config.no_contraction);
 }
 
-template<class Graph>
+// With map_eq the partition elements optimize the map equation instead of modularity
+template<bool map_eq = false, class Graph>
 auto partitionedLocalMoving(const Graph& graph, Logging::Id loggin_id) {
   constexpr bool weighted = std::is_same<typename Graph::Node, NodeWithWeightedLinks>::value;
   using Node = typename std::conditional<weighted, NodeWithWeightedLinksAndTargetDegree, NodeWithLinksAndTargetDegree>::type;
 
+  // cut of the singleton clustering, the map equation of an element depends on the cut of the whole graph
+  Weight total_cut = 0;
+  if (map_eq) {
+    total_cut = graph.nodes.Keep().Map([](const typename Graph::Node& node) { return node.weightedDegree() - node.loopWeight(); }).Sum();
+  }
+
   uint32_t partition_size = graph.nodes.context().num_workers();
   uint32_t partition_element_size = Partitioning::partitionElementTargetSize(graph.node_count, partition_size);
   if (partition_element_size < 100000 && graph.node_count < 1000000) {
@@ -340,7 +354,7 @@ auto partitionedLocalMoving(const Graph& graph, Logging::Id loggin_id) {
     // Local Moving
     .template GroupToIndex<std::vector<std::pair<typename Graph::Node, ClusterId>>>(
       [](const std::pair<Node, uint32_t>& node_partition) -> size_t { return node_partition.second; },
-      [total_weight = graph.total_weight, partition_element_size, partition_size, loggin_id](auto& iterator, const uint32_t) {
+      [total_weight = graph.total_weight, total_cut, partition_element_size, partition_size, loggin_id](auto& iterator, const uint32_t) {
         // TODO deterministic random
         GhostGraph<weighted> graph(partition_element_size, total_weight);
         const std::vector<typename Graph::Node> reverse_mapping = graph.template initialize<typename Graph::Node>(
@@ -349,13 +363,20 @@ auto partitionedLocalMoving(const Graph& graph, Logging::Id loggin_id) {
               emit(iterator.Next().first);
             }
           });
+        PhaseStats::count(PhaseStats::GhostGraphBytes, graph.memoryUsage());
 
         std::vector<std::pair<typename Graph::Node, ClusterId>> mapping;
         mapping.reserve(graph.getNodeCount());
         if (partition_size > 1) {
           GhostClusterStore clusters(graph.getNodeCount());
 
-          Modularity::localMoving(graph, clusters);
+          if (map_eq) {
+            MapEq::localMoving(graph, clusters, total_cut);
+          } else if (WorkerThreads::count() > 1) {
+            Modularity::parallelLocalMoving(graph, clusters);
+          } else {
+            Modularity::localMoving(graph, clusters);
+          }
 
           clusters.rewriteClusterIds(reverse_mapping);
           for (NodeId node = 0; node < graph.getNodeCount(); node++) {
@@ -366,8 +387,17 @@ auto partitionedLocalMoving(const Graph& graph, Logging::Id loggin_id) {
 
           Logging::Id seq_algo_logging_id = Logging::getUnusedId();
           Logging::report("algorithm_run", seq_algo_logging_id, "distributed_algorithm_run_id", loggin_id);
-          Logging::report("algorithm_run", seq_algo_logging_id, "algorithm", "sequential louvain");
-          Louvain::louvainModularity(graph, clusters, seq_algo_logging_id);
+          if (map_eq) {
+            Logging::report("algorithm_run", seq_algo_logging_id, "algorithm", "sequential louvain with map equation");
+            Louvain::louvainMapEq(graph, clusters, seq_algo_logging_id, 0, /* nested */ true);
+          } else if (WorkerThreads::count() > 1) {
+            Logging::report("algorithm_run", seq_algo_logging_id, "algorithm", "shared memory parallel louvain");
+            Logging::report("algorithm_run", seq_algo_logging_id, "threads", WorkerThreads::count());
+            Louvain::parallelLouvainModularity(graph, clusters, seq_algo_logging_id, 0, /* nested */ true);
+          } else {
+            Logging::report("algorithm_run", seq_algo_logging_id, "algorithm", "sequential louvain");
+            Louvain::louvainModularity(graph, clusters, seq_algo_logging_id, 0, /* nested */ true);
+          }
 
           clusters.rewriteClusterIds();
 
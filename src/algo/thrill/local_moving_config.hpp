@@ -0,0 +1,129 @@
+#pragma once
+
+#include <thrill/api/all_reduce.hpp>
+
+#include <tlx/cmdline_parser.hpp>
+
+#include <algorithm>
+
+#include "util/util.hpp"
+#include "util/logging.hpp"
+#include "data/thrill/graph.hpp"
+
+namespace LocalMoving {
+
+struct GraphStats {
+  size_t node_count;
+  double average_degree;
+  Weight max_degree;
+  // max degree / average degree, large for web graphs with a few huge hubs
+  double degree_skew;
+};
+
+template<class NodeType>
+GraphStats graphStats(const DiaNodeGraph<NodeType>& graph) {
+  Weight max_degree = graph.nodes
+    .Keep()
+    .Map([](const NodeType& node) { return node.weightedDegree(); })
+    .AllReduce([](const Weight a, const Weight b) { return std::max(a, b); });
+
+  double average_degree = graph.node_count > 0 ? 2. * graph.total_weight / graph.node_count : 0;
+  return GraphStats { graph.node_count, average_degree, max_degree, average_degree > 0 ? max_degree / average_degree : 0 };
+}
+
+// Parameters of the synchronous local moving, formerly compile time flags (FIXED_RATIO, STOP_MOVECOUNT, ...)
+struct Config {
+  // each node is considered in one of node_ratio sub rounds per round, 0 means a dynamic ratio
+  unsigned node_ratio = 4;
+  // stop a level when the cluster count shrunk by less than 1% in a round instead of when less than 2% of the nodes moved
+  bool stop_on_cluster_count = false;
+  // levels with fewer edges are gathered on the first worker and clustered with the shared memory parallel louvain, 0 disables this
+  size_t switch_to_seq_edge_count = 0;
+  // 0 means 8 rounds with a fixed ratio and 32 sub rounds with a dynamic one
+  unsigned max_iterations = 0;
+  bool no_contraction = false;
+  bool automatic = false;
+
+  void addOptions(tlx::CmdlineParser& cp, const bool with_sequential_fallback) {
+    cp.add_unsigned('r', "node-ratio", "unsigned int", node_ratio, "Sub rounds per round, every node is considered in one of them. 0 for a dynamic ratio");
+    cp.add_flag('c', "stop-on-cluster-count", stop_on_cluster_count, "Stop local moving when the cluster count shrunk by less than 1% in a round instead of when less than 2% of the nodes moved");
+    cp.add_unsigned('i', "max-iterations", "unsigned int", max_iterations, "Maximum number of sub rounds per level, 0 for 8 rounds");
+    if (with_sequential_fallback) {
+      cp.add_size_t('q', "switch-to-seq", "edge count", switch_to_seq_edge_count, "Cluster levels with fewer edges on one host using all its cores, 0 to stay distributed");
+    }
+    cp.add_flag('n', "no-contraction", no_contraction, "Stop after the local moving of the first level");
+    cp.add_flag('a', "auto", automatic, "Derive ratio, iterations and sequential switch from the graph, overrides -r, -c, -i and -q");
+  }
+
+  // Sub rounds keep neighbors from moving at the same time. Sparse graphs have few such conflicts,
+  // on skewed graphs hubs attract many simultaneous moves and need more sub rounds.
+  // Levels which fit comfortably on one host are cheaper to cluster there than to spend further synchronous rounds on.
+  void deriveFrom(const GraphStats& stats, const bool with_sequential_fallback) {
+    if (stats.degree_skew > 64) {
+      node_ratio = 8;
+    } else if (stats.average_degree < 8) {
+      node_ratio = 2;
+    } else {
+      node_ratio = 4;
+    }
+    stop_on_cluster_count = false;
+    max_iterations = 8 * node_ratio;
+    switch_to_seq_edge_count = with_sequential_fallback ? 16000000 : 0;
+  }
+
+  unsigned maxIterations() const {
+    if (max_iterations > 0) {
+      return max_iterations;
+    }
+    return node_ratio > 0 ? 8 * node_ratio : 32;
+  }
+
+  uint32_t initialRate() const {
+    return node_ratio > 0 ? 1000 / node_ratio : 200;
+  }
+
+  bool nodeIncluded(const NodeId node, const uint32_t iteration, const uint32_t rate, const uint32_t seed) const {
+    if (node_ratio > 0) {
+      uint32_t hash = Util::combined_hash(node, iteration / node_ratio, seed);
+      return hash % node_ratio == iteration % node_ratio;
+    } else {
+      uint32_t hash = Util::combined_hash(node, iteration, seed);
+      return hash % 1000 < rate;
+    }
+  }
+
+  void report(const Logging::Id algorithm_run_id) const {
+    Logging::report("algorithm_run", algorithm_run_id, "local_moving_config", automatic ? "auto" : "manual");
+    if (node_ratio > 0) {
+      Logging::report("algorithm_run", algorithm_run_id, "local_moving_node_ratio", node_ratio);
+    } else {
+      Logging::report("algorithm_run", algorithm_run_id, "local_moving_node_ratio", "dynamic");
+    }
+    Logging::report("algorithm_run", algorithm_run_id, "local_moving_stopping_criterion", stop_on_cluster_count ? "cluster_count" : "moved_count");
+    Logging::report("algorithm_run", algorithm_run_id, "max_iterations", maxIterations());
+    Logging::report("algorithm_run", algorithm_run_id, "switch_to_seq", switch_to_seq_edge_count > 0);
+    if (switch_to_seq_edge_count > 0) {
+      Logging::report("algorithm_run", algorithm_run_id, "switch_to_seq_edge_count", switch_to_seq_edge_count);
+    }
+    Logging::report("algorithm_run", algorithm_run_id, "contraction", !no_contraction);
+  }
+};
+
+// Resolves auto mode against the input graph and reports the effective config
+template<class NodeType>
+Config effectiveConfig(Config config, const DiaNodeGraph<NodeType>& graph, const Logging::Id algorithm_run_id, const bool with_sequential_fallback) {
+  GraphStats stats = graphStats(graph);
+  if (config.automatic) {
+    config.deriveFrom(stats, with_sequential_fallback);
+  }
+
+  if (graph.nodes.context().my_rank() == 0) {
+    Logging::report("algorithm_run", algorithm_run_id, "average_degree", stats.average_degree);
+    Logging::report("algorithm_run", algorithm_run_id, "max_degree", stats.max_degree);
+    Logging::report("algorithm_run", algorithm_run_id, "degree_skew", stats.degree_skew);
+    config.report(algorithm_run_id);
+  }
+  return config;
+}
+
+} // LocalMoving
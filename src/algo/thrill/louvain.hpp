@@ -9,13 +9,18 @@
 #include <thrill/api/write_binary.hpp>
 #include <thrill/api/zip_with_index.hpp>
 
+#include <tlx/cmdline_parser.hpp>
+
 #include <vector>
 #include <cstdlib>
+#include <string>
 #include <sparsepp/spp.h>
 
 #include "util/thrill/input.hpp"
 #include "util/util.hpp"
 #include "util/logging.hpp"
+#include "util/worker_threads.hpp"
+#include "util/thrill/phase_stats.hpp"
 #include "algo/thrill/clustering_quality.hpp"
 #include "algo/thrill/contraction.hpp"
 
@@ -27,6 +32,13 @@ auto louvain(const DiaNodeGraph<NodeType>& graph, Logging::Id algorithm_run_id,
   if (graph.nodes.context().my_rank() == 0) {
     level_logging_id = Logging::getUnusedId();
   }
+  PhaseStats::LevelRecord& level_stats = PhaseStats::worker.enterLevel(level, level_logging_id);
+
+  // the rss is shared by all workers of a host, so one of them resets the peak once all are here
+  graph.nodes.context().net.Barrier();
+  if (graph.nodes.context().local_worker_id() == 0) {
+    Memory::resetPeakRSS();
+  }
 
   if (level == 0) {
     graph.nodes.Execute();
@@ -35,20 +47,29 @@ auto louvain(const DiaNodeGraph<NodeType>& graph, Logging::Id algorithm_run_id,
     }
   }
 
+  PhaseStats::Scope local_moving_scope(PhaseStats::LocalMoving);
   auto lm_result = local_moving(graph, seed, level_logging_id);
+  // the result may still be lazy (partitioned local moving, the distribution after switching to the sequential algorithm),
+  // so run it while the local moving is timed
+  auto node_clusters = lm_result.first.Cache();
+  node_clusters.Execute();
+  local_moving_scope.stop();
+  level_stats.notePeakRSS();
 
   if (lm_result.second) {
     if (graph.nodes.context().my_rank() == 0) {
       Logging::report_timestamp("algorithm_run", algorithm_run_id, "done_ts");
     }
-    return lm_result.first.Map([](const std::pair<NodeType, ClusterId>& node_cluster) { return NodeCluster(node_cluster.first.id, node_cluster.second); }).Collapse();
+    return node_clusters.Map([](const std::pair<NodeType, ClusterId>& node_cluster) { return NodeCluster(node_cluster.first.id, node_cluster.second); }).Collapse();
   } else {
     if (graph.nodes.context().my_rank() == 0) {
       Logging::report_timestamp("algorithm_level", level_logging_id, "local_moving_done_ts");
     }
   }
 
-  auto clusters_with_nodes = lm_result.first
+  PhaseStats::Scope contraction_scope(PhaseStats::Contraction);
+
+  auto clusters_with_nodes = node_clusters
     .template FoldByKey<std::vector<NodeType>>(thrill::NoDuplicateDetectionTag,
       [](const std::pair<NodeType, ClusterId>& node_cluster) { return node_cluster.second; },
       [](std::vector<NodeType>&& acc, const std::pair<NodeType, ClusterId>& node_cluster) {
@@ -148,6 +169,8 @@ auto louvain(const DiaNodeGraph<NodeType>& graph, Logging::Id algorithm_run_id,
     Logging::report("algorithm_level", level_logging_id, "meta_edge_count", num_meta_edges);
     Logging::report_timestamp("algorithm_level", level_logging_id, "contraction_done_ts");
   }
+  contraction_scope.stop();
+  level_stats.notePeakRSS();
 
   auto meta_result = louvain(DiaNodeGraph<NodeWithWeightedLinks> { meta_nodes, cluster_count, graph.total_weight }, algorithm_run_id, seed, local_moving, level + 1);
   return meta_result
@@ -165,97 +188,105 @@ auto louvain(const DiaNodeGraph<NodeType>& graph, Logging::Id algorithm_run_id,
     .ReducePairToIndex([](const ClusterId id, const ClusterId) { assert(false); return id; }, graph.node_count);
 }
 
+// cp may carry algorithm specific options, graph and clustering output are added here
 template<class F>
-auto performAndEvaluate(int argc, char const *argv[], const std::string& algo, const F& run) {
+int performAndEvaluate(int argc, char const *argv[], tlx::CmdlineParser& cp, const std::string& algo, const F& run) {
+  std::string graph_file = "";
+  std::string clustering_output = "";
+  cp.add_param_string("graph", graph_file, "The graph to perform clustering on, or generate:<spec>");
+  cp.add_opt_param_string("clustering", clustering_output, "Where to write the clustering, optionally followed by ,<logging id>");
+
+  if (!cp.process(argc, argv)) {
+    return 1;
+  }
+
   return thrill::Run([&](thrill::Context& context) {
     context.enable_consume();
+    PhaseStats::worker.reset();
+    WorkerThreads::configure();
 
-    auto graph = Input::readToNodeGraph(argv[1], context);
+    // weighted inputs are read into NodeWithWeightedLinks, so the algorithm is instantiated for both node types
+    auto perform = [&](const auto& read_graph) {
+      auto graph = read_graph();
 
-    uint32_t seed = 42;
-    if (getenv("SEED")) {
-      seed = std::stoi(getenv("SEED"));
-    }
+      uint32_t seed = 42;
+      if (getenv("SEED")) {
+        seed = std::stoi(getenv("SEED"));
+      }
 
-    Logging::Id program_run_logging_id;
-    if (context.my_rank() == 0) {
-      program_run_logging_id = Logging::getUnusedId();
-      Logging::report("program_run", program_run_logging_id, "binary", argv[0]);
-      Logging::report("program_run", program_run_logging_id, "hosts", context.num_hosts());
-      Logging::report("program_run", program_run_logging_id, "total_workers", context.num_workers());
-      Logging::report("program_run", program_run_logging_id, "workers_per_host", context.workers_per_host());
-      Logging::report("program_run", program_run_logging_id, "graph", argv[1]);
-      Logging::report("program_run", program_run_logging_id, "node_count", graph.node_count);
-      Logging::report("program_run", program_run_logging_id, "edge_count", graph.total_weight);
-      Logging::report("program_run", program_run_logging_id, "seed", seed);
-      if (getenv("MOAB_JOBID")) {
-        Logging::report("program_run", program_run_logging_id, "job_id", getenv("MOAB_JOBID"));
+      Logging::Id program_run_logging_id;
+      if (context.my_rank() == 0) {
+        program_run_logging_id = Logging::getUnusedId();
+        Logging::report("program_run", program_run_logging_id, "binary", argv[0]);
+        Logging::report("program_run", program_run_logging_id, "hosts", context.num_hosts());
+        Logging::report("program_run", program_run_logging_id, "total_workers", context.num_workers());
+        Logging::report("program_run", program_run_logging_id, "workers_per_host", context.workers_per_host());
+        Logging::report("program_run", program_run_logging_id, "threads_per_worker", WorkerThreads::count());
+        Logging::report("program_run", program_run_logging_id, "graph", graph_file);
+        Logging::report("program_run", program_run_logging_id, "node_count", graph.node_count);
+        Logging::report("program_run", program_run_logging_id, "edge_count", graph.total_weight);
+        Logging::report("program_run", program_run_logging_id, "seed", seed);
+        if (getenv("MOAB_JOBID")) {
+          Logging::report("program_run", program_run_logging_id, "job_id", getenv("MOAB_JOBID"));
+        }
       }
 
-      #if defined(FIXED_RATIO)
-        Logging::report("program_run", program_run_logging_id, "local_moving_node_ratio", FIXED_RATIO);
-      #else
-        Logging::report("program_run", program_run_logging_id, "local_moving_node_ratio", "dynamic");
-      #endif
-      #if defined(STOP_MOVECOUNT)
-        Logging::report("program_run", program_run_logging_id, "local_moving_stopping_criterion", "moved_count");
-      #else
-        Logging::report("program_run", program_run_logging_id, "local_moving_stopping_criterion", "cluster_count");
-      #endif
-      #if defined(MAX_ITERATIONS)
-        Logging::report("program_run", program_run_logging_id, "max_iterations", MAX_ITERATIONS);
-      #endif
-      #if defined(SWITCH_TO_SEQ)
-        Logging::report("program_run", program_run_logging_id, "switch_to_seq", true);
-      #else
-        Logging::report("program_run", program_run_logging_id, "switch_to_seq", false);
-      #endif
-      #if defined(NO_CONTRACTION)
-        Logging::report("program_run", program_run_logging_id, "contraction", false);
-      #else
-        Logging::report("program_run", program_run_logging_id, "contraction", true);
-      #endif
-    }
+      Logging::Id algorithm_run_id = 0;
+      if (context.my_rank() == 0) {
+        algorithm_run_id = Logging::getUnusedId();
+        Logging::report("algorithm_run", algorithm_run_id, "program_run_id", program_run_logging_id);
+        Logging::report("algorithm_run", algorithm_run_id, "algorithm", algo);
+      }
+      auto node_clusters = run(graph, algorithm_run_id, seed);
+      node_clusters.Execute();
+      PhaseStats::worker.leaveLevels();
+      if (!clustering_output.empty()) {
+        auto clustering_input = Logging::parse_input_with_logging_id(clustering_output);
+        node_clusters.Keep().WriteBinary(clustering_input.first);
+      }
 
-    Logging::Id algorithm_run_id = 0;
-    if (context.my_rank() == 0) {
-      algorithm_run_id = Logging::getUnusedId();
-      Logging::report("algorithm_run", algorithm_run_id, "program_run_id", program_run_logging_id);
-      Logging::report("algorithm_run", algorithm_run_id, "algorithm", algo);
-    }
-    auto node_clusters = run(graph, algorithm_run_id, seed);
-    node_clusters.Execute();
-    if (argc > 2) {
-      auto clustering_input = Logging::parse_input_with_logging_id(argv[2]);
-      node_clusters.Keep().WriteBinary(clustering_input.first);
-    }
+      PhaseStats::Scope evaluation_scope(PhaseStats::Evaluation);
+      size_t cluster_count = node_clusters.Keep().Map([](const NodeCluster& node_cluster) { return node_cluster.second; }).Uniq().Size();
+
+      auto eval_graph = read_graph();
+      eval_graph.nodes.Keep();
+      double modularity = ClusteringQuality::modularity(eval_graph, node_clusters.Keep());
+      double map_eq = ClusteringQuality::mapEquation(eval_graph, node_clusters);
+      evaluation_scope.stop();
+      PhaseStats::reportAcrossWorkers(context, algorithm_run_id);
 
-    size_t cluster_count = node_clusters.Keep().Map([](const NodeCluster& node_cluster) { return node_cluster.second; }).Uniq().Size();
-
-    auto eval_graph = Input::readToNodeGraph(argv[1], context);
-    eval_graph.nodes.Keep();
-    double modularity = ClusteringQuality::modularity(eval_graph, node_clusters.Keep());
-    double map_eq = ClusteringQuality::mapEquation(eval_graph, node_clusters);
-
-    if (context.my_rank() == 0) {
-      if (argc > 2) {
-        auto clustering_input = Logging::parse_input_with_logging_id(argv[2]);
-        Logging::report("clustering", clustering_input.second, "path", clustering_input.first);
-        Logging::report("clustering", clustering_input.second, "source", "computation");
-        Logging::report("clustering", clustering_input.second, "algorithm_run_id", algorithm_run_id);
-        Logging::report("clustering", clustering_input.second, "modularity", modularity);
-        Logging::report("clustering", clustering_input.second, "map_equation", map_eq);
-        Logging::report("clustering", clustering_input.second, "cluster_count", cluster_count);
-      } else {
-        Logging::Id clusters_logging_id = Logging::getUnusedId();
-        Logging::report("clustering", clusters_logging_id, "source", "computation");
-        Logging::report("clustering", clusters_logging_id, "algorithm_run_id", algorithm_run_id);
-        Logging::report("clustering", clusters_logging_id, "modularity", modularity);
-        Logging::report("clustering", clusters_logging_id, "map_equation", map_eq);
-        Logging::report("clustering", clusters_logging_id, "cluster_count", cluster_count);
+      if (context.my_rank() == 0) {
+        if (!clustering_output.empty()) {
+          auto clustering_input = Logging::parse_input_with_logging_id(clustering_output);
+          Logging::report("clustering", clustering_input.second, "path", clustering_input.first);
+          Logging::report("clustering", clustering_input.second, "source", "computation");
+          Logging::report("clustering", clustering_input.second, "algorithm_run_id", algorithm_run_id);
+          Logging::report("clustering", clustering_input.second, "modularity", modularity);
+          Logging::report("clustering", clustering_input.second, "map_equation", map_eq);
+          Logging::report("clustering", clustering_input.second, "cluster_count", cluster_count);
+        } else {
+          Logging::Id clusters_logging_id = Logging::getUnusedId();
+          Logging::report("clustering", clusters_logging_id, "source", "computation");
+          Logging::report("clustering", clusters_logging_id, "algorithm_run_id", algorithm_run_id);
+          Logging::report("clustering", clusters_logging_id, "modularity", modularity);
+          Logging::report("clustering", clusters_logging_id, "map_equation", map_eq);
+          Logging::report("clustering", clusters_logging_id, "cluster_count", cluster_count);
+        }
       }
+    };
+
+    if (GraphFormat::isWeighted(graph_file)) {
+      perform([&]() { return Input::readToWeightedNodeGraph(graph_file, context); });
+    } else {
+      perform([&]() { return Input::readToNodeGraph(graph_file, context); });
     }
   });
 }
 
+template<class F>
+int performAndEvaluate(int argc, char const *argv[], const std::string& algo, const F& run) {
+  tlx::CmdlineParser cp;
+  return performAndEvaluate(argc, argv, cp, algo, run);
+}
+
 } // Louvain
@@ -1,8 +1,9 @@
 #pragma once
 
+#include <thrill/api/all_gather.hpp>
+#include <thrill/api/cache.hpp>
 #include <thrill/api/collapse.hpp>
 #include <thrill/api/distribute.hpp>
-#include <thrill/api/fold_by_key.hpp>
 #include <thrill/api/gather.hpp>
 #include <thrill/api/group_by_key.hpp>
 #include <thrill/api/group_to_index.hpp>
@@ -10,13 +11,17 @@
 #include <thrill/api/reduce_by_key.hpp>
 #include <thrill/api/reduce_to_index.hpp>
 #include <thrill/api/size.hpp>
+#include <thrill/api/sum.hpp>
 #include <thrill/api/zip.hpp>
 #include <thrill/api/zip_with_index.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <sparsepp/spp.h>
 
 #include "util/util.hpp"
+#include "util/logging.hpp"
 
 #include "algo/partitioning.hpp"
 
@@ -39,25 +44,141 @@ bool nodeIncluded(const NodeId node, const uint32_t iteration) {
   return hash % LP_FIXED_RATIO == iteration % LP_FIXED_RATIO;
 }
 
+struct LabelPropagationLink {
+  NodeId node;
+  Label label;
+  Weight weight;
+};
+
+// Node state of the label propagation. The adjacency stays fixed, only the labels of the neighbors
+// are updated when a neighbor announces a change.
+struct LabelPropagationNode {
+  NodeId id;
+  Label label;
+  bool changed;
+  // sorted by node
+  std::vector<LabelPropagationLink> neighbors;
+};
+
+struct LabelDelta {
+  NodeId target;
+  NodeIdLabel source;
+};
+
+namespace thrill {
+namespace data {
+template <typename Archive>
+struct Serialization<Archive, LabelPropagationNode> {
+  static void Serialize(const LabelPropagationNode& node, Archive& ar) {
+    Serialization<Archive, NodeId>::Serialize(node.id, ar);
+    Serialization<Archive, Label>::Serialize(node.label, ar);
+    Serialization<Archive, bool>::Serialize(node.changed, ar);
+    Serialization<Archive, std::vector<LabelPropagationLink>>::Serialize(node.neighbors, ar);
+  }
+  static LabelPropagationNode Deserialize(Archive& ar) {
+    return LabelPropagationNode {
+      Serialization<Archive, NodeId>::Deserialize(ar),
+      Serialization<Archive, Label>::Deserialize(ar),
+      Serialization<Archive, bool>::Deserialize(ar),
+      Serialization<Archive, std::vector<LabelPropagationLink>>::Deserialize(ar)
+    };
+  }
+  static constexpr bool is_fixed_size = false;
+  static constexpr size_t fixed_size = 0;
+};
+} // data
+} // thrill
+
+// Each round only the nodes which changed their label in the previous round send it to their neighbors.
+// Nodes join the label with the largest link weight among their neighbors.
+// Labels with at least target_partition_element_size nodes are not joined by further nodes, 0 for unlimited labels.
 template<class Graph>
-auto label_propagation(Graph& graph, uint32_t max_num_iterations, uint32_t target_partition_element_size) {
+auto label_propagation(const Graph& graph, uint32_t max_num_iterations, uint32_t target_partition_element_size) {
   using Node = typename Graph::Node;
-  using Link = typename Node::LinkType;
-  using NodeLabel = std::pair<Node, Label>;
-
-  auto select_most_frequent_label = [node_count = graph.node_count](const auto& node_labels, uint32_t iteration) {
-    return node_labels
-      .template GroupToIndex<Label>(
-        [](const NodeIdLabel& label) { return label.node; },
-        [iteration](auto& iterator, const NodeId) {
-          spp::sparse_hash_map<Label, uint32_t> label_counts;
+
+  // everyone starts in their own label, so the initial neighbor labels are the neighbor ids
+  auto nodes = graph.nodes
+    .Keep()
+    .Map([](const Node& node) {
+      LabelPropagationNode lp_node { node.id, node.id, false, {} };
+      lp_node.neighbors.reserve(node.links.size());
+      for (const auto& link : node.links) {
+        if (link.target != node.id) {
+          lp_node.neighbors.push_back(LabelPropagationLink { link.target, link.target, link.getWeight() });
+        }
+      }
+      std::sort(lp_node.neighbors.begin(), lp_node.neighbors.end(), [](const LabelPropagationLink& a, const LabelPropagationLink& b) { return a.node < b.node; });
+      return lp_node;
+    })
+    // index aligned like the grouped deltas, so they can be zipped without rebalancing
+    .ReduceToIndex(
+      [](const LabelPropagationNode& node) -> size_t { return node.id; },
+      [](const LabelPropagationNode& node, const LabelPropagationNode&) { assert(false); return node; },
+      graph.node_count)
+    .Cache();
+
+  for (uint32_t iteration = 0; iteration < max_num_iterations; iteration++) {
+    std::vector<Label> full_labels;
+    if (target_partition_element_size > 0) {
+      full_labels = nodes
+        .Keep()
+        .Map([](const LabelPropagationNode& node) { return std::make_pair(node.label, NodeId(1)); })
+        .ReducePair([](const NodeId a, const NodeId b) { return a + b; })
+        .Filter([target_partition_element_size](const std::pair<Label, NodeId>& label_size) { return label_size.second >= target_partition_element_size; })
+        .Map([](const std::pair<Label, NodeId>& label_size) { return label_size.first; })
+        .AllGather();
+      std::sort(full_labels.begin(), full_labels.end());
+    }
+
+    auto deltas = nodes
+      .Keep()
+      .template FlatMap<LabelDelta>(
+        [](const LabelPropagationNode& node, auto emit) {
+          if (node.changed) {
+            for (const LabelPropagationLink& neighbor : node.neighbors) {
+              emit(LabelDelta { neighbor.node, NodeIdLabel { node.id, node.label } });
+            }
+          }
+        })
+      .template GroupToIndex<std::vector<NodeIdLabel>>(
+        [](const LabelDelta& delta) -> size_t { return delta.target; },
+        [](auto& iterator, const NodeId) {
+          std::vector<NodeIdLabel> updates;
           while (iterator.HasNext()) {
-            label_counts[iterator.Next().label]++;
+            updates.push_back(iterator.Next().source);
+          }
+          return updates;
+        },
+        graph.node_count);
+
+    nodes = nodes
+      .Zip(thrill::NoRebalanceTag, deltas,
+        [iteration, full_labels](LabelPropagationNode node, const std::vector<NodeIdLabel>& updates) {
+          for (const NodeIdLabel& update : updates) {
+            auto neighbor = std::lower_bound(node.neighbors.begin(), node.neighbors.end(), update.node, [](const LabelPropagationLink& link, const NodeId id) { return link.node < id; });
+            assert(neighbor != node.neighbors.end() && neighbor->node == update.node);
+            // parallel links appear multiple times
+            for (; neighbor != node.neighbors.end() && neighbor->node == update.node; neighbor++) {
+              neighbor->label = update.label;
+            }
+          }
+
+          node.changed = false;
+          if (!nodeIncluded(node.id, iteration)) {
+            return node;
+          }
+
+          spp::sparse_hash_map<Label, Weight> label_counts;
+          label_counts[node.label]++;
+          for (const LabelPropagationLink& neighbor : node.neighbors) {
+            if (neighbor.label == node.label || !std::binary_search(full_labels.begin(), full_labels.end(), neighbor.label)) {
+              label_counts[neighbor.label] += neighbor.weight;
+            }
           }
 
           uint32_t win_counter = 1;
-          uint32_t highest_occurence = 0;
-          Label best_label = 0;
+          Weight highest_occurence = 0;
+          Label best_label = node.label;
           for (const auto& pair : label_counts) {
             if (pair.second > highest_occurence) {
               highest_occurence = pair.second;
@@ -72,63 +193,23 @@ auto label_propagation(Graph& graph, uint32_t max_num_iterations, uint32_t targe
             }
           }
 
-          return best_label;
-        },
-        node_count);
-  };
-
-  auto node_labels = graph.nodes.Keep().Map([](const Node& node) { return NodeLabel(node, node.id); }).Collapse();
-
-  for (uint32_t iteration = 0; iteration < max_num_iterations; iteration++) {
-    auto included = [iteration](const NodeId id) { return nodeIncluded(id, iteration); };
-
-    auto new_node_labels = (iteration < max_num_iterations / 3 ?
-      select_most_frequent_label(node_labels
-        .template FlatMap<NodeIdLabel>(
-          [&included](const NodeLabel& node_label, auto emit) {
-            for (const Link& neighbor : node_label.first.links) {
-              if (included(neighbor.target)) {
-                emit(NodeIdLabel { neighbor.target, node_label.second });
-              }
-            }
-            emit(NodeIdLabel { node_label.first.id, node_label.second });
-          }), iteration) :
-      select_most_frequent_label(node_labels
-        .template FoldByKey<std::vector<Node>>(thrill::NoDuplicateDetectionTag,
-            [](const NodeLabel& node_label) { return node_label.second; },
-            [](std::vector<Node>&& acc, const NodeLabel& node_label) {
-              acc.push_back(node_label.first);
-              return std::move(acc);
-            })
-        .template FlatMap<NodeIdLabel>(
-          [target_partition_element_size, &included](const std::pair<Label, std::vector<Node>>& label_nodes, auto emit) {
-            for (const Node& node : label_nodes.second) {
-              for (const Link& neighbor : node.links) {
-                if (label_nodes.second.size() < target_partition_element_size) {
-                  if (included(neighbor.target)) {
-                    emit(NodeIdLabel { neighbor.target, label_nodes.first });
-                  }
-                }
-              }
-              emit(NodeIdLabel { node.id, label_nodes.first });
-            }
-          }), iteration));
+          node.changed = best_label != node.label;
+          node.label = best_label;
+          return node;
+        })
+      .Cache();
 
-    size_t num_changed = new_node_labels
+    size_t num_changed = nodes
       .Keep()
-      .Zip(node_labels, [](const Label& l1, const NodeLabel& l2) { return std::make_pair(l1, l2.second); })
-      .Filter([](const std::pair<Label, Label>& labels) { return labels.first != labels.second; })
-      .Size();
-
-    node_labels = new_node_labels
-      .Zip(graph.nodes.Keep(), [](const Label label, const Node& node) { return NodeLabel(node, label); });
+      .Map([](const LabelPropagationNode& node) -> size_t { return node.changed ? 1 : 0; })
+      .Sum();
 
     if (num_changed <= graph.node_count / (100 * LP_FIXED_RATIO)) {
       break;
     }
   }
 
-  return node_labels.Map([](const NodeLabel& node_label) { return NodeIdLabel { node_label.first.id, node_label.second }; });
+  return nodes.Map([](const LabelPropagationNode& node) { return NodeIdLabel { node.id, node.label }; });
 }
 
 template<class Graph>
@@ -176,3 +257,80 @@ auto partition(const Graph& graph, const uint32_t partition_size) {
       graph.node_count);
 }
 
+
+// Distributed counterpart of Partitioning::analyse: every element is gathered on one worker, like for partitioned local moving,
+// and analysed there with compact ids. Reports on the first worker and returns the element logging ids there.
+template<class Graph, class NodePartitions>
+std::vector<Logging::Id> analysePartition(const Graph& graph, const NodePartitions& node_partitions, const uint32_t partition_size, const Logging::Id partition_logging_id) {
+  using Node = typename Graph::Node;
+  using ElementStats = std::pair<Partitioning::PartitionElementStats, Weight>;
+
+  auto element_stats = graph.nodes
+    .Keep()
+    .Zip(node_partitions.Keep(), [](const Node& node, const NodePartition& node_partition) {
+      assert(node.id == node_partition.node_id);
+      return std::make_pair(node, node_partition.partition);
+    })
+    .template GroupToIndex<ElementStats>(
+      [](const std::pair<Node, uint32_t>& node_partition) -> size_t { return node_partition.second; },
+      [](auto& iterator, const size_t) {
+        std::vector<Node> nodes;
+        while (iterator.HasNext()) {
+          nodes.push_back(iterator.Next().first);
+        }
+
+        std::vector<NodeId> node_ids(nodes.size());
+        std::vector<std::atomic<NodeId>> parents(nodes.size());
+        for (NodeId local = 0; local < nodes.size(); local++) {
+          node_ids[local] = nodes[local].id;
+          parents[local].store(local, std::memory_order_relaxed);
+        }
+        std::sort(node_ids.begin(), node_ids.end());
+        std::vector<NodeId> local_ids(nodes.size());
+        for (NodeId local = 0; local < nodes.size(); local++) {
+          local_ids[std::lower_bound(node_ids.begin(), node_ids.end(), nodes[local].id) - node_ids.begin()] = local;
+        }
+
+        Weight cut_weight = 0;
+        std::vector<NodeId> ghosts;
+        for (NodeId local = 0; local < nodes.size(); local++) {
+          for (const auto& link : nodes[local].links) {
+            auto it = std::lower_bound(node_ids.begin(), node_ids.end(), link.target);
+            if (it != node_ids.end() && *it == link.target) {
+              Partitioning::uniteComponents(parents, local, local_ids[it - node_ids.begin()]);
+            } else {
+              cut_weight += link.getWeight();
+              ghosts.push_back(link.target);
+            }
+          }
+        }
+        std::sort(ghosts.begin(), ghosts.end());
+
+        NodeId component_count = 0;
+        for (NodeId local = 0; local < nodes.size(); local++) {
+          if (Partitioning::findComponent(parents, local) == local) {
+            component_count++;
+          }
+        }
+
+        return ElementStats(Partitioning::PartitionElementStats {
+          NodeId(nodes.size()),
+          NodeId(std::unique(ghosts.begin(), ghosts.end()) - ghosts.begin()),
+          component_count
+        }, cut_weight);
+      },
+      partition_size)
+    .Gather();
+
+  if (graph.nodes.context().my_rank() != 0) {
+    return std::vector<Logging::Id>();
+  }
+
+  Weight cut_weight = 0;
+  std::vector<Partitioning::PartitionElementStats> stats;
+  for (const ElementStats& element : element_stats) {
+    cut_weight += element.second;
+    stats.push_back(element.first);
+  }
+  return Partitioning::reportPartitionStats(cut_weight / 2, stats, partition_logging_id);
+}
@@ -16,12 +16,16 @@
 
 #include <vector>
 #include <algorithm>
+#include <numeric>
 #include <sparsepp/spp.h>
 
 #include "algo/louvain.hpp"
 #include "util/util.hpp"
 #include "util/logging.hpp"
+#include "util/phase_stats.hpp"
+#include "util/worker_threads.hpp"
 #include "data/thrill/graph.hpp"
+#include "algo/thrill/local_moving_config.hpp"
 #include "data/local_dia_graph.hpp"
 
 namespace LocalMoving {
@@ -75,20 +79,10 @@ double deltaMapEq(const Weight node_degree,
   return result[0] + ((result[3] - result[4]) - (2 * (result[1] - result[2])));
 };
 
-bool nodeIncluded(const NodeId node, const uint32_t iteration, const uint32_t rate, const uint32_t seed) {
-  #if defined(FIXED_RATIO)
-    uint32_t hash = Util::combined_hash(node, iteration / FIXED_RATIO, seed);
-    return hash % FIXED_RATIO == iteration % FIXED_RATIO;
-  #else
-    uint32_t hash = Util::combined_hash(node, iteration, seed);
-    return hash % 1000 < rate;
-  #endif
-}
-
 static_assert(sizeof(EdgeTargetWithDegree) == 8, "Too big");
 
 template<class NodeType>
-auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_iterations, const uint32_t seed, Logging::Id level_logging_id) {
+auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, const Config& config, const uint32_t seed, Logging::Id level_logging_id) {
   thrill::common::Range id_range = thrill::common::CalculateLocalRange(graph.node_count, graph.nodes.context().num_workers(), graph.nodes.context().my_rank());
 
   std::vector<std::pair<Weight, Weight>> node_degrees;
@@ -152,17 +146,25 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
         [](const std::pair<ClusterId, std::vector<NodeType>>& cluster_nodes) {
           spp::sparse_hash_set<NodeId> cluster_node_ids;
           cluster_node_ids.reserve(cluster_nodes.second.size());
-          Weight cut = 0;
+          size_t link_count = 0;
           for (const NodeType& node : cluster_nodes.second) {
             cluster_node_ids.insert(node.id);
+            link_count += node.links.size();
           }
-          for (const NodeType& node : cluster_nodes.second) {
-            for (const typename NodeType::LinkType& link : node.links) {
-              if (node.id != link.target && cluster_node_ids.find(link.target) == cluster_node_ids.end()) {
-                cut += link.getWeight();
+          // the set is only read from here on, large clusters are scanned by all worker threads
+          const uint32_t shards = WorkerThreads::shardsFor(link_count);
+          std::vector<Weight> shard_cuts(shards, 0);
+          WorkerThreads::forEachShard(shards, [&](const uint32_t shard) {
+            for (size_t i = shard; i < cluster_nodes.second.size(); i += shards) {
+              const NodeType& node = cluster_nodes.second[i];
+              for (const typename NodeType::LinkType& link : node.links) {
+                if (node.id != link.target && cluster_node_ids.find(link.target) == cluster_node_ids.end()) {
+                  shard_cuts[shard] += link.getWeight();
+                }
               }
             }
-          }
+          });
+          Weight cut = std::accumulate(shard_cuts.begin(), shard_cuts.end(), Weight(0));
           return std::make_pair(cluster_nodes, cut);
         });
 
@@ -173,38 +175,47 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
         [&included](const std::pair<std::pair<ClusterId, std::vector<NodeType>>, Weight>& cluster_info, auto emit) {
           const auto& cluster_nodes = cluster_info.first;
           const Weight cut = cluster_info.second;
-          spp::sparse_hash_map<NodeId, Weight> node_inbetween_weight;
           Weight total_weight = 0;
+          size_t link_count = 0;
 
           for (const NodeType& node : cluster_nodes.second) {
             total_weight += node.weightedDegree();
+            link_count += node.links.size();
           }
 
-          for (const NodeType& node : cluster_nodes.second) {
-            for (const typename NodeType::LinkType& link : node.links) {
-              if (node.id != link.target && included(link.target)) {
-                node_inbetween_weight[link.target] += link.getWeight();
+          // large clusters are split into node ranges over the worker threads, summed up by link target
+          const uint32_t shards = WorkerThreads::shardsFor(link_count);
+          std::vector<spp::sparse_hash_map<NodeId, Weight>> node_inbetween_weight = WorkerThreads::sumByKey<spp::sparse_hash_map<NodeId, Weight>>(
+            cluster_nodes.second, shards,
+            [](const NodeType& node) { return node.links.size(); },
+            [&included](const NodeType& node, const auto& emit) {
+              for (const typename NodeType::LinkType& link : node.links) {
+                if (node.id != link.target && included(link.target)) {
+                  emit(link.target, link.getWeight());
+                }
+              }
+              if (included(node.id)) {
+                emit(node.id, 0);
               }
-            }
-            if (included(node.id)) {
-               node_inbetween_weight[node.id] += 0;
-            }
-          }
-
-          for (const auto& node_cluster_link : node_inbetween_weight) {
-            emit(IncidentClusterInfo {
-              node_cluster_link.first,
-              cluster_nodes.first,
-              node_cluster_link.second,
-              total_weight,
-              cut
             });
+
+          for (const auto& shard_weights : node_inbetween_weight) {
+            for (const auto& node_cluster_link : shard_weights) {
+              emit(IncidentClusterInfo {
+                node_cluster_link.first,
+                cluster_nodes.first,
+                node_cluster_link.second,
+                total_weight,
+                cut
+              });
+            }
           }
         });
   };
 
   auto reduceToBestCluster = [&graph, &total_cut, &id_range, &node_degree, &loop_weight, &cluster](const auto& incoming) {
     return incoming
+      .Map([](const IncidentClusterInfo& lme) { PhaseStats::count(PhaseStats::EmittedRecords); return lme; })
       // Reduce to best cluster
       .template GroupToIndex<IncidentClusterInfo>(
         [](const IncidentClusterInfo& lme) -> size_t { return lme.node_id; },
@@ -220,6 +231,8 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
             }
           }
 
+          PhaseStats::count(PhaseStats::CandidateClusters, incoming.size());
+
           IncidentClusterInfo best_cluster = current_cluster_info;
           double best_delta = deltaMapEq(node_degree(node), loop_weight(node), current_cluster_info, current_cluster_info, total_cut, total_weight);
 
@@ -237,20 +250,13 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
   };
 
 
-  #if !defined(STOP_MOVECOUNT)
-    size_t cluster_count = graph.node_count;
-  #endif
-
-  #if defined(FIXED_RATIO)
-    uint32_t rate = 1000 / FIXED_RATIO;
-  #else
-    uint32_t rate = 200;
-  #endif
+  size_t cluster_count = graph.node_count;
+  uint32_t rate = config.initialRate();
   uint32_t rate_sum = 0;
 
   uint32_t iteration;
-  for (iteration = 0; iteration < num_iterations; iteration++) {
-    auto included = [iteration, rate, seed](const NodeId id) { return nodeIncluded(id, iteration, rate, seed); };
+  for (iteration = 0; iteration < config.maxIterations(); iteration++) {
+    auto included = [&config, iteration, rate, seed](const NodeId id) { return config.nodeIncluded(id, iteration, rate, seed); };
 
     clusters.clear();
     node_clusters.Keep().Map([](const std::pair<std::pair<NodeType, ClusterId>, bool>& node_cluster_moved) { return node_cluster_moved.first.second; }).CollectLocal(&clusters);
@@ -258,6 +264,7 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
     size_t considered_nodes_estimate = graph.node_count * rate / 1000;
 
     if (considered_nodes_estimate > 0) {
+      PhaseStats::Scope label_exchange_scope(PhaseStats::LabelExchange);
       node_clusters = (iteration == 0 ?
         reduceToBestCluster(first_iteration(included, node_clusters)) :
         reduceToBestCluster(other_iterations(included, node_clusters.Keep())))
@@ -265,27 +272,33 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
           [&included](const IncidentClusterInfo& lme, const std::pair<std::pair<NodeType, ClusterId>, bool>& old_node_cluster) {
             if (included(old_node_cluster.first.first.id)) {
               assert(lme.node_id == old_node_cluster.first.first.id);
+              if (lme.cluster != old_node_cluster.first.second) {
+                PhaseStats::count(PhaseStats::Moves);
+              }
               return std::make_pair(std::make_pair(old_node_cluster.first.first, lme.cluster), lme.cluster != old_node_cluster.first.second);
             } else {
               return std::make_pair(old_node_cluster.first, false);
             }
           })
         .Cache();
+      // the DIA operations above are lazy, run them while the label exchange is timed
+      node_clusters.Execute();
 
       rate_sum += rate;
-      #if !defined(FIXED_RATIO) || defined(STOP_MOVECOUNT)
-      size_t moved = node_clusters.Keep().Filter([&included](const std::pair<std::pair<NodeType, ClusterId>, bool>& pair) { return pair.second && included(pair.first.first.id); }).Size();
-      #endif
-      #if !defined(FIXED_RATIO)
+      size_t moved = 0;
+      if (config.node_ratio == 0 || !config.stop_on_cluster_count) {
+        moved = node_clusters.Keep().Filter([&included](const std::pair<std::pair<NodeType, ClusterId>, bool>& pair) { return pair.second && included(pair.first.first.id); }).Size();
+      }
+      if (config.node_ratio == 0) {
         rate = std::max(1000 - (moved * 1000 / considered_nodes_estimate), 200ul);
-      #endif
+      }
 
       if (rate_sum >= 1000) {
-        #if defined(STOP_MOVECOUNT)
+        if (!config.stop_on_cluster_count) {
           if (moved <= graph.node_count / 50) {
             break;
           }
-        #else
+        } else {
           size_t round_cluster_count = node_clusters.Keep().Map([](const std::pair<std::pair<NodeType, ClusterId>, bool>& node_cluster) { return node_cluster.first.second; }).Uniq().Size();
           assert(graph.node_count == node_clusters.Size());
 
@@ -294,14 +307,12 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
           }
 
           cluster_count = round_cluster_count;
-        #endif
+        }
         rate_sum -= 1000;
       }
-    } else {
-      #if !defined(FIXED_RATIO)
-        rate += 200;
-        if (rate > 1000) { rate = 1000; }
-      #endif
+    } else if (config.node_ratio == 0) {
+      rate += 200;
+      if (rate > 1000) { rate = 1000; }
     }
   }
   if (node_clusters.context().my_rank() == 0) {
@@ -313,6 +324,6 @@ auto distributedLocalMoving(const DiaNodeGraph<NodeType>& graph, uint32_t num_it
       [](const std::pair<std::pair<NodeType, ClusterId>, bool>& node_cluster) {
         return node_cluster.first;
       }).Collapse(),
-    false);
+    config.no_contraction);
 }
 } // LocalMoving
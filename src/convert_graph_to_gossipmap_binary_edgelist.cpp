@@ -35,12 +35,18 @@ int main(int argc, char const *argv[]) {
 
   std::ofstream out_stream(output_path, std::ios::binary);
 
-  IO::stream_bin_graph(graph_paths, [&](const NodeId u, const NodeId v) {
-
-			static_assert(std::is_same<uint32_t, NodeId>::value, "Node type is not uint32 anymore, adjust code!");
-			out_stream.write(reinterpret_cast<const char*>(&u), 4);
-			out_stream.write(reinterpret_cast<const char*>(&v), 4);
-    });
+  static_assert(std::is_same<uint32_t, NodeId>::value, "Node type is not uint32 anymore, adjust code!");
+  std::vector<NodeId> edges;
+  IO::stream_bin_nodes(graph_paths, [&](const NodeId u, const NodeId* neighbors, const size_t degree) {
+    edges.clear();
+    for (size_t i = 0; i < degree; i++) {
+      edges.push_back(u);
+      edges.push_back(neighbors[i]);
+      edges.push_back(neighbors[i]);
+      edges.push_back(u);
+    }
+    out_stream.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(NodeId));
+  });
 
   out_stream.close();
 
@@ -1,8 +1,8 @@
 #pragma once
 
 #include <vector>
-#include <unordered_map>
 #include <algorithm>
+#include <limits>
 
 #include <routingkit/bit_vector.h>
 #include <routingkit/id_mapper.h>
@@ -33,22 +33,27 @@ public:
     std::iota(clusters.begin(), clusters.end(), 0);
   }
 
+  // Cluster ids are local or ghost node ids, so a dense array indexed by them replaces a hash map
   template<class Node>
   void rewriteClusterIds(const std::vector<Node>& id_space) {
+    if (clusters.empty()) {
+      return;
+    }
     size_t id_counter = 0;
-    std::unordered_map<NodeId, ClusterId> old_to_new;
+    const ClusterId unmapped = std::numeric_limits<ClusterId>::max();
+    std::vector<ClusterId> old_to_new(*std::max_element(clusters.begin(), clusters.end()) + 1, unmapped);
 
     for (ClusterId& cluster_id : clusters) {
-      if (old_to_new.find(cluster_id) == old_to_new.end()) {
+      if (old_to_new[cluster_id] == unmapped) {
         old_to_new[cluster_id] = id_space[id_counter++].id;
       }
-      ClusterId new_id = old_to_new[cluster_id];
-      cluster_id = new_id;
+      cluster_id = old_to_new[cluster_id];
     }
   }
 
+  // Compacts to id_counter.., returns the next unused id. Clusters may be identified by ghost node ids.
   ClusterId rewriteClusterIds(ClusterId id_counter = 0) {
-    RoutingKit::BitVector vector(size());
+    RoutingKit::BitVector vector(clusters.empty() ? 0 : *std::max_element(clusters.begin(), clusters.end()) + 1);
 
     for (ClusterId cluster_id : clusters) {
       vector.set(cluster_id);
@@ -3,11 +3,11 @@
 #include <algorithm>
 #include <numeric>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <iostream>
 #include <assert.h>
-#include <map>
-#include <unordered_map>
 #include <cstdint>
 
 #include "data/thrill/graph.hpp"
@@ -17,6 +17,8 @@ class GhostGraph {
 
 private:
 
+  using NodeWithTargetDegrees = typename std::conditional<weighted, NodeWithWeightedLinksAndTargetDegree, NodeWithLinksAndTargetDegree>::type;
+
   std::vector<size_t> first_out;
   std::vector<Weight> degrees;
   std::vector<NodeId> neighbors;
@@ -35,56 +37,87 @@ public:
     }
   }
 
+  // Maps the global ids of the emitted nodes to 0..n-1 in emit order and those of ghost targets to n.. in ascending order.
+  // The emitted nodes are kept until all local ids are known, then the CSR arrays are sized once and filled,
+  // target degrees are only picked up for ghost edges. Ids are compacted with sorted arrays instead of hash maps.
   template<class Node, class F>
   std::vector<Node> initialize(const F& f) {
-    std::unordered_map<NodeId, NodeId> id_mapping;
-    std::map<NodeId, Weight> ghost_node_degrees;
-    NodeId id_counter = 0;
-    size_t edge_counter = 0;
-
-    std::vector<Node> reverse_mapping;
-    reverse_mapping.reserve(first_out.capacity());
-
-    f([this, &id_mapping, &id_counter, &ghost_node_degrees, &reverse_mapping, &edge_counter](const auto& node) {
-      reverse_mapping.push_back(node.toNodeWithoutTargetDegrees());
-      id_mapping[node.id] = id_counter++;
+    std::vector<NodeWithTargetDegrees> nodes;
+    nodes.reserve(first_out.capacity() - 1);
 
+    f([this, &nodes](NodeWithTargetDegrees node) {
       first_out.push_back(first_out.back() + node.links.size());
       if (weighted) {
         degrees.push_back(node.weightedDegree());
       }
+      nodes.push_back(std::move(node));
+    });
 
-      neighbors.reserve(edge_counter * first_out.capacity() / first_out.size());
-      if (weighted) {
-        weights.reserve(edge_counter * first_out.capacity() / first_out.size());
-      }
-      for (const auto& link : node.links) {
-        neighbors.push_back(link.target);
-        if (weighted) {
-          weights.push_back(link.getWeight());
-        }
-        edge_counter++;
+    const NodeId node_count = getNodeCount();
+    std::vector<std::pair<NodeId, NodeId>> local_ids(node_count);
+    for (NodeId node = 0; node < node_count; node++) {
+      local_ids[node] = std::make_pair(nodes[node].id, node);
+    }
+    // partition elements usually arrive ordered by id
+    if (!std::is_sorted(local_ids.begin(), local_ids.end())) {
+      std::sort(local_ids.begin(), local_ids.end());
+    }
+
+    // buckets over the high bits of the ids, so each lookup only searches the few local ids of its bucket
+    const NodeId max_id = node_count > 0 ? local_ids.back().first : 0;
+    uint32_t shift = 0;
+    while ((max_id >> shift) > node_count) {
+      shift++;
+    }
+    std::vector<NodeId> bucket_begin((max_id >> shift) + 2, 0);
+    for (const auto& local_id : local_ids) {
+      bucket_begin[(local_id.first >> shift) + 1]++;
+    }
+    std::partial_sum(bucket_begin.begin(), bucket_begin.end(), bucket_begin.begin());
 
-        if (id_mapping.find(link.target) != id_mapping.end()) {
-          ghost_node_degrees[link.target] = link.target_degree;
+    neighbors.resize(first_out.back());
+    if (weighted) {
+      weights.resize(first_out.back());
+    }
+    // global target, edge and target degree
+    std::vector<std::tuple<NodeId, size_t, Weight>> ghost_edges;
+    std::vector<Node> reverse_mapping;
+    reverse_mapping.reserve(node_count);
+
+    for (NodeId node = 0; node < node_count; node++) {
+      size_t edge = first_out[node];
+      for (const auto& link : nodes[node].links) {
+        auto bucket_end = local_ids.begin();
+        auto it = bucket_end;
+        if (link.target <= max_id) {
+          const NodeId bucket = link.target >> shift;
+          bucket_end = local_ids.begin() + bucket_begin[bucket + 1];
+          it = std::lower_bound(local_ids.begin() + bucket_begin[bucket], bucket_end, std::make_pair(link.target, NodeId(0)));
+        }
+        if (it != bucket_end && it->first == link.target) {
+          neighbors[edge] = it->second;
+        } else {
+          ghost_edges.emplace_back(link.target, edge, link.target_degree);
         }
+        if (weighted) {
+          weights[edge] = link.getWeight();
+        }
+        edge++;
       }
-    });
 
-    for (NodeId& neighbor : neighbors) {
-      if (id_mapping.find(neighbor) != id_mapping.end()) {
-        neighbor = id_mapping[neighbor];
-      } else {
-        id_mapping[neighbor] = id_counter;
-        neighbor = id_counter++;
-      }
+      reverse_mapping.push_back(nodes[node].toNodeWithoutTargetDegrees());
+      // so the links are not held twice
+      std::vector<typename NodeWithTargetDegrees::LinkType>().swap(nodes[node].links);
     }
+    std::sort(ghost_edges.begin(), ghost_edges.end());
 
-    degrees.resize(weighted ? id_counter : id_counter - getNodeCount());
-
-    for (const auto& pair : ghost_node_degrees) {
-      if (id_mapping[pair.first] >= getNodeCount()) {
-        degrees[id_mapping[pair.first] - (weighted ? 0 : getNodeCount())] = pair.second;
+    NodeId id_counter = node_count;
+    for (size_t i = 0; i < ghost_edges.size(); i++) {
+      if (i > 0 && std::get<0>(ghost_edges[i]) == std::get<0>(ghost_edges[i - 1])) {
+        neighbors[std::get<1>(ghost_edges[i])] = id_counter - 1;
+      } else {
+        degrees.push_back(std::get<2>(ghost_edges[i]));
+        neighbors[std::get<1>(ghost_edges[i])] = id_counter++;
       }
     }
 
@@ -104,6 +137,11 @@ public:
   size_t getEdgeCount() const { return neighbors.size() / 2; }
   Weight getTotalWeight() const { return total_weight; }
 
+  size_t memoryUsage() const {
+    return first_out.capacity() * sizeof(size_t) + degrees.capacity() * sizeof(Weight)
+      + neighbors.capacity() * sizeof(NodeId) + weights.capacity() * sizeof(Weight);
+  }
+
   void overrideTotalWeight(const Weight weight) { total_weight = weight; }
 
   Weight nodeDegree(const NodeId node_id) const {
@@ -39,6 +39,13 @@ public:
       initializeAccumulatedWeights();
     }
 
+  // unweighted graph from a symmetric CSR
+  Graph(std::vector<EdgeId> first_out, std::vector<NodeId> neighbors) :
+    node_count(first_out.size() - 1), edge_count(neighbors.size() / 2), weighted(false),
+    first_out(std::move(first_out)), neighbors(std::move(neighbors)) {
+      initializeAccumulatedWeights();
+    }
+
   NodeId getNodeCount() const { return node_count; }
   NodeId getNodeCountIncludingGhost() const { return node_count; }
   EdgeId getEdgeCount() const { return edge_count; }
@@ -0,0 +1,23 @@
+#include <tlx/cmdline_parser.hpp>
+
+#include "algo/thrill/label_propagation.hpp"
+#include "algo/thrill/louvain.hpp"
+
+
+int main(int argc, char const *argv[]) {
+  unsigned max_iterations = 64;
+  bool no_contraction = false;
+  tlx::CmdlineParser cp;
+  cp.add_unsigned('i', "max-iterations", "unsigned int", max_iterations, "Maximum number of label propagation sub rounds per level");
+  cp.add_flag('n', "no-contraction", no_contraction, "Stop after the label propagation of the first level");
+
+  return Louvain::performAndEvaluate(argc, argv, cp, "distributed label propagation", [&](const auto& graph, Logging::Id logging_id, uint32_t seed) {
+    if (graph.nodes.context().my_rank() == 0) {
+      Logging::report("algorithm_run", logging_id, "max_iterations", max_iterations);
+      Logging::report("algorithm_run", logging_id, "contraction", !no_contraction);
+    }
+    return Louvain::louvain(graph, logging_id, seed, [&](const auto& graph, uint32_t, Logging::Id) {
+      return LocalMoving::labelPropagation(graph, max_iterations, no_contraction);
+    });
+  });
+}
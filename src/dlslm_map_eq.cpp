@@ -1,17 +1,18 @@
-#if defined(FIXED_RATIO)
-  #define MAX_ITERATIONS 8 * FIXED_RATIO
-#else
-  #define MAX_ITERATIONS 32
-#endif
+#include <tlx/cmdline_parser.hpp>
 
 #include "algo/thrill/synchronous_map_equation.hpp"
 #include "algo/thrill/louvain.hpp"
 
 
 int main(int argc, char const *argv[]) {
-  return Louvain::performAndEvaluate(argc, argv, "synchronous local moving with map equation", [](const auto& graph, Logging::Id logging_id, uint32_t seed) {
-    return Louvain::louvain(graph, logging_id, seed, [](const auto& graph, uint32_t seed, Logging::Id level_logging_id) {
-      return LocalMoving::distributedLocalMoving(graph, MAX_ITERATIONS, seed, level_logging_id);
+  LocalMoving::Config config;
+  tlx::CmdlineParser cp;
+  config.addOptions(cp, false);
+
+  return Louvain::performAndEvaluate(argc, argv, cp, "synchronous local moving with map equation", [&config](const auto& graph, Logging::Id logging_id, uint32_t seed) {
+    const LocalMoving::Config effective_config = LocalMoving::effectiveConfig(config, graph, logging_id, false);
+    return Louvain::louvain(graph, logging_id, seed, [&effective_config](const auto& graph, uint32_t seed, Logging::Id level_logging_id) {
+      return LocalMoving::distributedLocalMoving(graph, effective_config, seed, level_logging_id);
     });
   });
 }
@@ -0,0 +1,42 @@
+#include <thrill/api/write_binary.hpp>
+
+#include <tlx/cmdline_parser.hpp>
+
+#include <string>
+
+#include "util/thrill/graph_generator.hpp"
+#include "util/logging.hpp"
+
+int main(int argc, char const *argv[]) {
+  std::string spec = "";
+  std::string output = "";
+  std::string ground_truth_output = "";
+  tlx::CmdlineParser cp;
+  cp.add_param_string("spec", spec, "The generator, e.g. rmat:scale=20,edge_factor=16 or lfr:n=1000000,mixing=0.4 (see GraphGenerator::Spec)");
+  cp.add_param_string("output", output, "Output path in the preprocessed binary format, e.g. graph-@@@@-#####.bin");
+  cp.add_string('g', "ground-truth", "file", ground_truth_output, "Where to write the ground truth clustering (lfr only)");
+
+  if (!cp.process(argc, argv)) {
+    return 1;
+  }
+
+  return thrill::Run([&](thrill::Context& context) {
+    context.enable_consume();
+
+    auto graph = GraphGenerator::generateNodeGraph(spec, context);
+    if (!ground_truth_output.empty()) {
+      GraphGenerator::generateGroundTruth(spec, context).WriteBinary(ground_truth_output);
+    }
+    GraphGenerator::writeBinary(graph, output);
+
+    if (context.my_rank() == 0) {
+      Logging::Id program_run_logging_id = Logging::getUnusedId();
+      Logging::report("program_run", program_run_logging_id, "binary", argv[0]);
+      Logging::report("program_run", program_run_logging_id, "total_workers", context.num_workers());
+      Logging::report("program_run", program_run_logging_id, "generator", spec);
+      Logging::report("program_run", program_run_logging_id, "graph", output);
+      Logging::report("program_run", program_run_logging_id, "node_count", graph.node_count);
+      Logging::report("program_run", program_run_logging_id, "edge_count", graph.total_weight);
+    }
+  });
+}
@@ -1,3 +1,4 @@
+#include <thrill/api/cache.hpp>
 #include <thrill/api/write_lines_one.hpp>
 
 #include <tlx/cmdline_parser.hpp>
@@ -42,8 +43,14 @@ int main(int argc, char const *argv[]) {
       }
     }
 
-    partition(graph, partition_size)
-      .Execute();
+    auto node_partitions = partition(graph, partition_size).Cache();
+
+    Logging::Id partition_logging_id = 0;
+    if (context.my_rank() == 0) {
+      partition_logging_id = Logging::getUnusedId();
+      Logging::report("partition", partition_logging_id, "algorithm", "label_propagation");
+    }
+    analysePartition(graph, node_partitions, partition_size, partition_logging_id);
       // .Map([](const NodePartition& node_partition) { return std::to_string(node_partition.partition); })
       // .WriteLinesOne(out_file.empty() ? graph_file + ".part" : out_file);
   });
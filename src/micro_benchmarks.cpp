@@ -0,0 +1,290 @@
+#include "data/graph.hpp"
+#include "data/cluster_store.hpp"
+#include "data/ghost_graph.hpp"
+#include "data/ghost_cluster_store.hpp"
+#include "data/thrill/graph.hpp"
+#include "algo/modularity.hpp"
+#include "algo/map_eq.hpp"
+#include "algo/contraction.hpp"
+#include "algo/similarity.hpp"
+#include "algo/thrill/contraction.hpp"
+#include "algo/thrill/synchronous_map_equation.hpp"
+#include "util/graph_generator.hpp"
+#include "util/io.hpp"
+#include "util/logging.hpp"
+#include "util/phase_stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <tlx/cmdline_parser.hpp>
+
+// Micro benchmarks of the clustering kernels on generated planted partition graphs.
+// All inputs and random engines are seeded, so consecutive runs measure the same work.
+
+struct Options {
+  unsigned min_scale = 14;
+  unsigned max_scale = 18;
+  unsigned repetitions = 5;
+  unsigned degree = 16;
+  double mixing = 0.3;
+  unsigned cluster_size = 64;
+  unsigned seed = 42;
+  std::string filter = "";
+  std::string tmp_dir = "/tmp";
+};
+
+class Runner {
+private:
+
+  const Options& options;
+  Logging::Id run_id;
+
+public:
+
+  Runner(const Options& options, const Logging::Id run_id) : options(options), run_id(run_id) {}
+
+  // prepare is called before every repetition and not measured
+  void run(const std::string& name, const Graph& graph, const std::function<void()>& prepare, const std::function<void()>& body) const {
+    if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+      return;
+    }
+
+    std::vector<double> times;
+    for (unsigned repetition = 0; repetition < options.repetitions; repetition++) {
+      Modularity::rng.seed(options.seed + repetition);
+      MapEq::rng.seed(options.seed + repetition);
+      prepare();
+
+      PhaseStats::Timer timer;
+      body();
+      times.push_back(timer.seconds());
+    }
+    std::sort(times.begin(), times.end());
+
+    Logging::Id benchmark_id = Logging::getUnusedId();
+    Logging::report("benchmark", benchmark_id, "program_run_id", run_id);
+    Logging::report("benchmark", benchmark_id, "name", name);
+    Logging::report("benchmark", benchmark_id, "node_count", graph.getNodeCount());
+    Logging::report("benchmark", benchmark_id, "edge_count", graph.getEdgeCount());
+    Logging::report("benchmark", benchmark_id, "repetitions", options.repetitions);
+    Logging::report("benchmark", benchmark_id, "time_min", times.front());
+    Logging::report("benchmark", benchmark_id, "time_median", times[times.size() / 2]);
+    Logging::report("benchmark", benchmark_id, "time_max", times.back());
+  }
+
+  void run(const std::string& name, const Graph& graph, const std::function<void()>& body) const {
+    run(name, graph, []() {}, body);
+  }
+};
+
+void write_dimacs(const std::string& filename, const Graph& graph) {
+  std::ofstream file(filename);
+  file << graph.getNodeCount() << " " << graph.getEdgeCount() << "\n";
+  for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+    graph.forEachAdjacentNode(node, [&file](const NodeId neighbor, Weight) {
+      file << neighbor + 1 << " ";
+    });
+    file << "\n";
+  }
+}
+
+// the format written by preprocess: per node a varint count followed by the higher neighbor ids
+void write_bin(const std::string& filename, const Graph& graph) {
+  std::ofstream file(filename, std::ios::binary);
+  std::vector<uint32_t> higher_neighbors;
+  for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+    higher_neighbors.clear();
+    graph.forEachAdjacentNode(node, [&](const NodeId neighbor, Weight) {
+      if (neighbor > node) {
+        higher_neighbors.push_back(neighbor);
+      }
+    });
+
+    uint64_t count = higher_neighbors.size();
+    while (count >= 0x80) {
+      file.put(char((count & 0x7F) | 0x80));
+      count >>= 7;
+    }
+    file.put(char(count));
+    file.write(reinterpret_cast<const char*>(higher_neighbors.data()), higher_neighbors.size() * sizeof(uint32_t));
+  }
+}
+
+void benchmark(const Runner& runner, const Options& options, const GraphGenerator::PlantedPartition& generator) {
+  const Graph graph = GraphGenerator::generate(generator);
+  ClusterStore ground_truth(graph.getNodeCount());
+  generator.groundTruth(ground_truth);
+
+  ClusterStore clusters(graph.getNodeCount());
+  runner.run("modularity_local_moving", graph, [&]() { clusters = ClusterStore(graph.getNodeCount()); }, [&]() {
+    Modularity::localMoving(graph, clusters);
+  });
+
+  runner.run("map_eq_local_moving", graph, [&]() { clusters = ClusterStore(graph.getNodeCount()); }, [&]() {
+    MapEq::localMoving(graph, clusters);
+  });
+
+  {
+    std::mt19937_64 rng(options.seed);
+    const ClusterId cluster_count = generator.clusterCount();
+    std::vector<Weight> cluster_cuts(cluster_count), cluster_volumes(cluster_count);
+    Weight total_inter_vol = 0;
+    graph.forEachEdge([&](const NodeId tail, const NodeId head, const Weight weight) {
+      cluster_volumes[ground_truth[tail]] += weight;
+      if (ground_truth[tail] != ground_truth[head]) {
+        cluster_cuts[ground_truth[tail]] += weight;
+        total_inter_vol += weight;
+      }
+    });
+
+    std::uniform_int_distribution<ClusterId> random_cluster(0, cluster_count - 1);
+    std::vector<ClusterId> targets(graph.getNodeCount());
+    for (ClusterId& target : targets) {
+      target = random_cluster(rng);
+    }
+
+    double sum = 0;
+    runner.run("map_eq_update_cost", graph, [&]() {
+      for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+        const Weight degree = graph.nodeDegree(node);
+        sum += MapEq::updateCost(2 * graph.getTotalWeight(), total_inter_vol, cluster_cuts, cluster_volumes, degree, 0, ground_truth[node], targets[node], degree / 4, degree / 2);
+      }
+    });
+
+    std::vector<LocalMoving::IncidentClusterInfo> infos(cluster_count);
+    for (ClusterId cluster = 0; cluster < cluster_count; cluster++) {
+      infos[cluster] = LocalMoving::IncidentClusterInfo { 0, cluster, 1, cluster_volumes[cluster], cluster_cuts[cluster] };
+    }
+    runner.run("delta_map_eq", graph, [&]() {
+      for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+        sum += LocalMoving::deltaMapEq(graph.nodeDegree(node), 0, infos[ground_truth[node]], infos[targets[node]], total_inter_vol, graph.getTotalWeight());
+      }
+    });
+    Logging::report("benchmark_checksum", Logging::getUnusedId(), "update_cost", sum);
+  }
+
+  runner.run("contraction", graph, [&]() { clusters = ground_truth; }, [&]() {
+    Contraction::contract(graph, clusters);
+  });
+
+  {
+    std::vector<std::vector<NodeWithWeightedLinks>> cluster_nodes(generator.clusterCount());
+    for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+      NodeWithWeightedLinks node_with_links { node, {} };
+      graph.forEachAdjacentNode(node, [&](const NodeId neighbor, const Weight weight) {
+        node_with_links.push_back(WeightedEdgeTarget { ground_truth[neighbor], weight });
+      });
+      cluster_nodes[ground_truth[node]].push_back(std::move(node_with_links));
+    }
+
+    runner.run("sort_and_merge_links", graph, [&]() {
+      for (ClusterId cluster = 0; cluster < cluster_nodes.size(); cluster++) {
+        Contraction::sort_and_merge_links(cluster_nodes[cluster], cluster, cluster_nodes.size());
+      }
+    });
+  }
+
+  {
+    // the first quarter of the nodes as the partition of a single worker
+    std::vector<NodeWithLinksAndTargetDegree> partition;
+    for (NodeId node = 0; node < graph.getNodeCount() / 4; node++) {
+      NodeWithLinksAndTargetDegree node_with_links { node, {} };
+      graph.forEachAdjacentNode(node, [&](const NodeId neighbor, Weight) {
+        node_with_links.push_back(EdgeTargetWithDegree { neighbor, uint32_t(graph.nodeDegree(neighbor)) });
+      });
+      partition.push_back(std::move(node_with_links));
+    }
+
+    runner.run("ghost_graph_initialize", graph, [&]() {
+      GhostGraph<false> ghost_graph(partition.size(), graph.getTotalWeight());
+      ghost_graph.initialize<NodeWithLinks>([&partition](const auto& emit) {
+        for (const NodeWithLinksAndTargetDegree& node : partition) {
+          emit(node);
+        }
+      });
+    });
+  }
+
+  {
+    const std::string prefix = options.tmp_dir + "/micro_benchmark_" + std::to_string(generator.node_count);
+    write_dimacs(prefix + ".graph", graph);
+    write_bin(prefix + ".bin", graph);
+
+    std::vector<std::vector<NodeId>> neighbors;
+    runner.run("io_read_graph", graph, [&]() { neighbors.clear(); }, [&]() {
+      IO::read_graph(prefix + ".graph", neighbors);
+    });
+    runner.run("io_read_graph_bin", graph, [&]() { neighbors.clear(); }, [&]() {
+      IO::read_graph_bin(prefix + ".bin", neighbors);
+    });
+    runner.run("io_read_graph_bin_parallel", graph, [&]() {
+      IO::read_graph_bin_parallel(prefix + ".bin");
+    });
+    uint64_t streamed = 0;
+    runner.run("io_stream_bin_graph", graph, [&]() {
+      IO::stream_bin_graph(prefix + ".bin", [&streamed](NodeId, NodeId) { streamed++; });
+    });
+
+    std::remove((prefix + ".graph").c_str());
+    std::remove((prefix + ".bin").c_str());
+  }
+
+  {
+    // ground truth against a copy with ten percent of the nodes moved to random clusters
+    std::mt19937_64 rng(options.seed);
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::uniform_int_distribution<ClusterId> random_cluster(0, generator.clusterCount() - 1);
+    ClusterStore perturbed = ground_truth;
+    for (NodeId node = 0; node < graph.getNodeCount(); node++) {
+      if (coin(rng) < 0.1) {
+        perturbed.set(node, random_cluster(rng));
+      }
+    }
+    // compact ids as after a clustering run, the intersection is sized by the product of the id ranges
+    ClusterStore compact_ground_truth = ground_truth;
+    compact_ground_truth.rewriteClusterIds();
+    perturbed.rewriteClusterIds();
+
+    double sum = 0;
+    runner.run("similarity_adjusted_rand_index", graph, [&]() { sum += Similarity::adjustedRandIndex(compact_ground_truth, perturbed); });
+    runner.run("similarity_nmi", graph, [&]() { sum += Similarity::normalizedMutualInformation(compact_ground_truth, perturbed); });
+    runner.run("similarity_precision_recall", graph, [&]() { sum += Similarity::weightedPrecisionRecall(compact_ground_truth, perturbed).first; });
+    Logging::report("benchmark_checksum", Logging::getUnusedId(), "similarity", sum);
+  }
+}
+
+int main(int argc, char const *argv[]) {
+  Options options;
+
+  tlx::CmdlineParser cp;
+  cp.add_unsigned('m', "min-scale", "unsigned int", options.min_scale, "Smallest graph has 2^min-scale nodes");
+  cp.add_unsigned('M', "max-scale", "unsigned int", options.max_scale, "Largest graph has 2^max-scale nodes");
+  cp.add_unsigned('r', "repetitions", "unsigned int", options.repetitions, "Repetitions per benchmark, min/median/max are reported");
+  cp.add_unsigned('d', "degree", "unsigned int", options.degree, "Degree of the nodes of the generated graphs");
+  cp.add_double('x', "mixing", "double", options.mixing, "Fraction of edges leaving the planted clusters");
+  cp.add_unsigned('c', "cluster-size", "unsigned int", options.cluster_size, "Size of the planted clusters");
+  cp.add_unsigned('s', "seed", "unsigned int", options.seed, "Seed of the generator and the algorithms");
+  cp.add_string('f', "filter", "string", options.filter, "Only run benchmarks whose name contains this");
+  cp.add_string('t', "tmp-dir", "path", options.tmp_dir, "Directory for the graph files of the IO benchmarks");
+
+  if (!cp.process(argc, argv)) {
+    return 1;
+  }
+
+  Logging::Id run_id = Logging::getUnusedId();
+  Logging::report("program_run", run_id, "binary", argv[0]);
+  Logging::report("program_run", run_id, "seed", options.seed);
+  Runner runner(options, run_id);
+
+  for (unsigned scale = options.min_scale; scale <= options.max_scale; scale++) {
+    benchmark(runner, options, GraphGenerator::PlantedPartition(NodeId(1) << scale, options.cluster_size, options.degree, options.mixing, options.seed));
+  }
+}
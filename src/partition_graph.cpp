@@ -0,0 +1,55 @@
+#include "data/graph.hpp"
+#include "algo/partitioning.hpp"
+#include "util/logging.hpp"
+#include "util/input.hpp"
+#include "util/io.hpp"
+
+#include <iostream>
+#include <string>
+#include <random>
+
+#include <thrill/common/stats_timer.hpp>
+#include <tlx/cmdline_parser.hpp>
+
+int main(int argc, char const *argv[]) {
+  Logging::Id run_id = Logging::getUnusedId();
+
+  unsigned partition_size = 16;
+  std::string objective = "fennel";
+  bool shuffled = false;
+  tlx::CmdlineParser cp;
+  cp.add_unsigned('k', "partition-size", "unsigned int", partition_size, "Number of partition elements");
+  cp.add_string('j', "objective", "fennel|ldg", objective, "Streaming objective, fennel or linear deterministic greedy");
+  cp.add_flag('r', "random-order", shuffled, "Stream the nodes in random order instead of by id");
+
+  Input input(argc, argv, run_id, cp);
+  input.initialize();
+
+  if (!input.shouldRun()) {
+    return input.getExitCode();
+  }
+
+  Modularity::rng = std::default_random_engine(input.getSeed());
+  const Graph& graph = input.getGraph();
+
+  std::vector<uint32_t> partitions(graph.getNodeCount());
+  thrill::common::StatsTimerBase<true> timer(/* autostart */ true);
+  Logging::Id partition_logging_id;
+  if (objective == "ldg") {
+    partition_logging_id = Partitioning::deterministicGreedyWithLinearPenalty(graph, partition_size, partitions, shuffled);
+  } else if (objective == "fennel") {
+    partition_logging_id = Partitioning::fennel(graph, partition_size, partitions, shuffled);
+  } else {
+    std::cerr << "unknown objective " << objective << std::endl;
+    return 1;
+  }
+  Logging::report("partition", partition_logging_id, "runtime", timer.Microseconds() / 1000000.0);
+  Logging::report("partition", partition_logging_id, "program_run_id", run_id);
+
+  Partitioning::analyse(graph, partitions, partition_logging_id);
+
+  if (input.shouldWriteOutput()) {
+    Logging::report("partition", partition_logging_id, "path", input.outputFile());
+    IO::write_partition(input.outputFile(), partitions);
+  }
+}
@@ -2,13 +2,230 @@
 #include <thrill/api/fold_by_key.hpp>
 #include <thrill/api/rebalance.hpp>
 #include <thrill/api/read_binary.hpp>
+#include <thrill/api/reduce_to_index.hpp>
+#include <thrill/api/sort.hpp>
 #include <thrill/api/write_binary.hpp>
 #include <thrill/api/zip.hpp>
 
 #include <vector>
 #include <algorithm>
+#include <cstdlib>
+#include <string>
 
 #include "util/thrill/input.hpp"
+#include "algo/thrill/partitioning.hpp"
+
+// Adjacency lists hold plain neighbor ids or, for weighted graphs, neighbors with the weight of the link
+using WeightedLink = std::pair<NodeId, Weight>;
+
+NodeId linkFromEdge(const Edge& edge) { return edge.head; }
+WeightedLink linkFromEdge(const WeightedEdge& edge) { return WeightedLink(edge.head, edge.weight); }
+
+// the link of node to its neighbor as an edge from the neighbor to node
+Edge reverseEdge(const NodeId node, const NodeId link) { return Edge { link, node }; }
+WeightedEdge reverseEdge(const NodeId node, const WeightedLink& link) { return WeightedEdge { link.first, node, link.second }; }
+
+NodeWithLinks toNode(const NodeId node, const std::vector<NodeId>& links) {
+  NodeWithLinks node_with_links { node, {} };
+  node_with_links.links.reserve(links.size());
+  for (const NodeId link : links) {
+    node_with_links.push_back(EdgeTarget { link });
+  }
+  return node_with_links;
+}
+
+NodeWithWeightedLinks toNode(const NodeId node, const std::vector<WeightedLink>& links) {
+  NodeWithWeightedLinks node_with_links { node, {} };
+  node_with_links.links.reserve(links.size());
+  for (const WeightedLink& link : links) {
+    node_with_links.push_back(WeightedEdgeTarget { link.first, link.second });
+  }
+  return node_with_links;
+}
+
+// Sorted neighbors as stored in the binary format, only the higher ones unless symmetric
+std::vector<NodeId> toStoredAdjacency(const NodeId node, const std::vector<NodeId>& links, const bool symmetric) {
+  std::vector<NodeId> neighbors;
+  neighbors.reserve(links.size());
+  for (NodeId id : links) {
+    if (symmetric || id > node) {
+      neighbors.push_back(id);
+    }
+  }
+  std::sort(neighbors.begin(), neighbors.end());
+  return neighbors;
+}
+
+// Parallel links are merged into one with the summed weight
+WeightedAdjacency toStoredAdjacency(const NodeId node, std::vector<WeightedLink> links, const bool symmetric) {
+  std::sort(links.begin(), links.end());
+  WeightedAdjacency adjacency;
+  for (const WeightedLink& link : links) {
+    if (symmetric || link.first > node) {
+      if (!adjacency.first.empty() && adjacency.first.back() == link.first) {
+        adjacency.second.back() += link.second;
+      } else {
+        adjacency.first.push_back(link.first);
+        adjacency.second.push_back(link.second);
+      }
+    }
+  }
+  return adjacency;
+}
+
+// Orders the nodes by the elements of a label propagation based partition, within an element by their current id.
+// Consecutive id ranges, and thus the node ranges of the workers, are then well connected internally.
+// Takes and returns the nodes in id order, the second DIA holds the new id of every node indexed by its current id.
+template<typename Link>
+std::pair<thrill::DIA<std::pair<NodeId, std::vector<Link>>>, thrill::DIA<NodeId>> localityOrder(const thrill::DIA<std::pair<NodeId, std::vector<Link>>>& nodes, const NodeId node_count, const uint32_t partition_size) {
+  using AdjacencyList = std::pair<NodeId, std::vector<Link>>;
+  using NodeType = decltype(toNode(NodeId(), std::vector<Link>()));
+  using EdgeType = decltype(reverseEdge(NodeId(), Link()));
+
+  auto graph_nodes = nodes
+    .Keep()
+    .Map([](const AdjacencyList& node) { return toNode(node.first, node.second); })
+    .Cache();
+
+  Weight total_weight = graph_nodes
+    .Keep()
+    .Map([](const NodeType& node) { return node.weightedDegree(); })
+    .Sum() / 2;
+
+  auto new_ids = partition(DiaNodeGraph<NodeType> { graph_nodes, node_count, total_weight }, partition_size)
+    .Map([](const NodePartition& node) { return std::make_pair(node.partition, node.node_id); })
+    .Sort()
+    .ZipWithIndex([](const std::pair<uint32_t, NodeId>& node, const NodeId new_id) { return std::make_pair(node.second, new_id); })
+    .ReduceToIndex(
+      [](const std::pair<NodeId, NodeId>& ids) -> size_t { return ids.first; },
+      [](const std::pair<NodeId, NodeId>& ids, const std::pair<NodeId, NodeId>&) { assert(false); return ids; },
+      node_count)
+    .Map([](const std::pair<NodeId, NodeId>& ids) { return ids.second; })
+    .Cache();
+
+  // every node tells its neighbors its new id, then takes its own
+  auto renamed_nodes = nodes
+    .Zip(new_ids.Keep(), [](const AdjacencyList& node, const NodeId new_id) { return std::make_pair(new_id, node.second); })
+    .template FlatMap<EdgeType>(
+      [](const AdjacencyList& node, auto emit) {
+        for (const Link& link : node.second) {
+          emit(reverseEdge(node.first, link));
+        }
+      })
+    .template GroupToIndex<std::vector<Link>>(
+      [](const EdgeType& edge) -> size_t { return edge.tail; },
+      [](auto& iterator, const NodeId) {
+        std::vector<Link> links;
+        while (iterator.HasNext()) {
+          links.push_back(linkFromEdge(iterator.Next()));
+        }
+        return links;
+      },
+      node_count)
+    .Zip(new_ids.Keep(), [](const std::vector<Link>& links, const NodeId new_id) { return std::make_pair(new_id, links); })
+    .ReduceToIndex(
+      [](const AdjacencyList& node) -> size_t { return node.first; },
+      [](const AdjacencyList& node, const AdjacencyList&) { assert(false); return node; },
+      node_count);
+
+  return std::make_pair(renamed_nodes.Collapse(), new_ids.Collapse());
+}
+
+struct Options {
+  char const * graph_input;
+  char const * ground_truth_input;
+  std::string output;
+  std::string ground_truth_output;
+  std::string permutation_output;
+  bool symmetric;
+  uint32_t locality_partition_size;
+};
+
+template<typename EdgeDIA>
+void preprocess(const EdgeDIA& edges, const Options& options, thrill::Context& context) {
+  using EdgeType = typename EdgeDIA::ValueType;
+  using Link = decltype(linkFromEdge(EdgeType()));
+  using AdjacencyList = std::pair<NodeId, std::vector<Link>>;
+
+  thrill::common::hash<NodeId> hasher;
+
+  auto comparator = [&hasher](const AdjacencyList& n1, const AdjacencyList& n2) {
+    size_t h1 = hasher(n1.first);
+    size_t h2 = hasher(n2.first);
+    return h1 < h2 || (h1 == h2 && n1.first < n2.first);
+  };
+
+  auto nodes_with_new_ids = edges
+    .Rebalance()
+    .template FoldByKey<std::vector<Link>>(thrill::NoDuplicateDetectionTag,
+      [](const EdgeType& edge) { return edge.tail; },
+      [](std::vector<Link>&& links, const EdgeType& edge) {
+        links.push_back(linkFromEdge(edge));
+        return std::move(links);
+      })
+    .Sort(comparator)
+    .ZipWithIndex([](const AdjacencyList& node, NodeId new_index) { return std::make_pair(new_index, node); });
+
+  auto cleanup_mapping = nodes_with_new_ids
+    .Map([](const std::pair<NodeId, AdjacencyList>& new_id_and_node) { return std::make_pair(new_id_and_node.second.first, new_id_and_node.first); })
+    .Collapse();
+
+  thrill::DIA<AdjacencyList> nodes = nodes_with_new_ids
+    .template FlatMap<EdgeType>(
+      [](const std::pair<NodeId, AdjacencyList>& new_id_and_node, auto emit) {
+        for (const Link& link : new_id_and_node.second.second) {
+          emit(reverseEdge(new_id_and_node.first, link));
+        }
+      })
+    .template FoldByKey<std::vector<Link>>(thrill::NoDuplicateDetectionTag,
+      [](const EdgeType& edge) { return edge.tail; },
+      [](std::vector<Link>&& links, const EdgeType& edge) {
+        links.push_back(linkFromEdge(edge));
+        return std::move(links);
+      })
+    .Sort(comparator)
+    .Zip(cleanup_mapping.Keep(),
+      [](const AdjacencyList& node, const std::pair<NodeId, NodeId>& id_mapping) {
+        assert(node.first == id_mapping.first);
+        return std::make_pair(id_mapping.second, node.second);
+      })
+    .Collapse();
+
+  if (options.locality_partition_size > 0) {
+    NodeId node_count = cleanup_mapping.Keep().Size();
+    auto locality_nodes_and_ids = localityOrder(nodes, node_count, options.locality_partition_size);
+    nodes = locality_nodes_and_ids.first;
+    // cleanup_mapping is ordered by the current id, just like the new ids
+    cleanup_mapping = cleanup_mapping
+      .Zip(locality_nodes_and_ids.second, [](const std::pair<NodeId, NodeId>& id_mapping, const NodeId new_id) { return std::make_pair(id_mapping.first, new_id); })
+      .Cache();
+
+    cleanup_mapping
+      .Keep()
+      .ReduceToIndex(
+        [](const std::pair<NodeId, NodeId>& id_mapping) -> size_t { return id_mapping.second; },
+        [](const std::pair<NodeId, NodeId>& id_mapping, const std::pair<NodeId, NodeId>&) { assert(false); return id_mapping; },
+        node_count)
+      .Map([](const std::pair<NodeId, NodeId>& id_mapping) { return id_mapping.first; })
+      .WriteBinary(options.permutation_output);
+  }
+
+  if (options.ground_truth_input) {
+    Input::readClustering(options.ground_truth_input, context)
+      .InnerJoin(cleanup_mapping,
+        [](const NodeCluster& node_cluster) { return node_cluster.first; },
+        [](const std::pair<NodeId, NodeId>& id_mapping) { return id_mapping.first; },
+        [](const NodeCluster& node_cluster, const std::pair<NodeId, NodeId>& id_mapping) {
+          return NodeCluster(id_mapping.second, node_cluster.second);
+        })
+      .WriteBinary(options.ground_truth_output);
+  }
+
+  const bool symmetric = options.symmetric;
+  nodes
+    .Map([symmetric](const AdjacencyList& node) { return toStoredAdjacency(node.first, node.second, symmetric); })
+    .WriteBinary(options.output);
+}
 
 int main(int argc, char const *argv[]) {
   std::string graph_file(argv[1]);
@@ -16,92 +233,44 @@ int main(int argc, char const *argv[]) {
   if (glob_index != std::string::npos) {
     graph_file.erase(graph_file.begin() + glob_index);
   }
-  std::string output = graph_file.replace(graph_file.begin() + graph_file.rfind('.'), graph_file.end(), "-preprocessed-@@@@-#####.bin");
+
+  Options options;
+  options.graph_input = argv[1];
+  options.ground_truth_input = nullptr;
+  // SYMMETRIC=1 keeps all neighbors of every node, the distributed binaries read such graphs without a shuffle
+  options.symmetric = getenv("SYMMETRIC") && std::string(getenv("SYMMETRIC")) == "1";
+  // LOCALITY_PARTITIONS=k orders the nodes by k label propagation based partition elements instead of randomly,
+  // so that the workers get well connected node ranges. The old id of every new id is written to *-permutation-*.bin
+  options.locality_partition_size = getenv("LOCALITY_PARTITIONS") ? std::stoul(getenv("LOCALITY_PARTITIONS")) : 0;
+  // WEIGHTED=1 merges parallel edges into weighted links, weighted inputs always yield weighted output
+  const bool weighted = (getenv("WEIGHTED") && std::string(getenv("WEIGHTED")) == "1") || GraphFormat::isWeighted(argv[1]);
+  std::string graph_name = graph_file.substr(0, graph_file.rfind('.'));
+  options.output = graph_name + "-preprocessed-@@@@-#####" + (weighted ? ".weighted" : "") + (options.symmetric ? ".sym.bin" : ".bin");
+  options.permutation_output = graph_name + "-permutation-@@@@-#####.bin";
 
   std::string ground_truth_file = "";
-  std::string ground_truth_output = "";
   if (argc > 2) {
     ground_truth_file = std::string(argv[2]);
     if (!ground_truth_file.empty()) {
+      options.ground_truth_input = argv[2];
       glob_index = ground_truth_file.find('*');
       if (glob_index != std::string::npos) {
         ground_truth_file.erase(ground_truth_file.begin() + glob_index);
       }
-      ground_truth_output = ground_truth_file.replace(ground_truth_file.begin() + ground_truth_file.rfind('.'), ground_truth_file.end(), "-preprocessed-@@@@-#####.bin");
+      options.ground_truth_output = ground_truth_file.replace(ground_truth_file.begin() + ground_truth_file.rfind('.'), ground_truth_file.end(), "-preprocessed-@@@@-#####.bin");
     }
   }
 
   return thrill::Run([&](thrill::Context& context) {
     context.enable_consume();
-    auto graph = Input::readToEdgeGraph<false>(argv[1], context);
-    // size_t old_node_count = graph.node_count;
-    thrill::common::hash<NodeId> hasher;
-
-    auto comparator = [&hasher](const std::pair<NodeId, std::vector<NodeId>>& n1, const std::pair<NodeId, std::vector<NodeId>>& n2) {
-      size_t h1 = hasher(n1.first);
-      size_t h2 = hasher(n2.first);
-      return h1 < h2 || (h1 == h2 && n1.first < n2.first);
-    };
-
-    auto nodes_with_new_ids = graph.edges
-      .Rebalance()
-      .template FoldByKey<std::vector<NodeId>>(thrill::NoDuplicateDetectionTag,
-        [](const Edge& edge) { return edge.tail; },
-        [](std::vector<NodeId>&& neighbors, const Edge& edge) {
-          neighbors.push_back(edge.head);
-          return std::move(neighbors);
-        })
-      .Sort(comparator)
-      .ZipWithIndex([](const std::pair<NodeId, std::vector<NodeId>>& node, NodeId new_index) { return std::make_pair(new_index, node); });
-
-    auto cleanup_mapping = nodes_with_new_ids
-      .Map([](const std::pair<NodeId, std::pair<NodeId, std::vector<NodeId>>>& new_id_and_node) { return std::make_pair(new_id_and_node.second.first, new_id_and_node.first); });
-
-    // NodeId node_count = cleanup_mapping.Keep().Size();
-
-    if (argc > 2 && !ground_truth_file.empty()) {
-      Input::readClustering(argv[2], context)
-        .InnerJoin(cleanup_mapping.Keep(),
-          [](const NodeCluster& node_cluster) { return node_cluster.first; },
-          [](const std::pair<NodeId, NodeId>& id_mapping) { return id_mapping.first; },
-          [](const NodeCluster& node_cluster, const std::pair<NodeId, NodeId>& id_mapping) {
-            return NodeCluster(id_mapping.second, node_cluster.second);
-          })
-        .WriteBinary(ground_truth_output);
+    if (GraphFormat::isWeighted(options.graph_input)) {
+      preprocess(Input::readToWeightedEdgeGraph<false>(options.graph_input, context).edges, options, context);
+    } else if (weighted) {
+      auto edges = Input::readToEdgeGraph<false>(options.graph_input, context).edges
+        .Map([](const Edge& edge) { return WeightedEdge { edge.tail, edge.head, 1 }; });
+      preprocess(edges, options, context);
+    } else {
+      preprocess(Input::readToEdgeGraph<false>(options.graph_input, context).edges, options, context);
     }
-
-    nodes_with_new_ids
-      .template FlatMap<Edge>(
-        [](const std::pair<NodeId, std::pair<NodeId, std::vector<NodeId>>>& new_id_and_node, auto emit) {
-          for (NodeId neighbor : new_id_and_node.second.second) {
-            emit(Edge { neighbor, new_id_and_node.first });
-          }
-        })
-      .template FoldByKey<std::vector<NodeId>>(thrill::NoDuplicateDetectionTag,
-        [](const Edge& edge) { return edge.tail; },
-        [](std::vector<NodeId>&& neighbors, const Edge& edge) {
-          neighbors.push_back(edge.head);
-          return std::move(neighbors);
-        })
-      .Sort(comparator)
-      .Zip(cleanup_mapping,
-        [](const std::pair<NodeId, std::vector<NodeId>>& node, const std::pair<NodeId, NodeId>& id_mapping) {
-          assert(node.first == id_mapping.first);
-          return std::make_pair(id_mapping.second, node.second);
-        })
-      .Map(
-        [](const std::pair<NodeId, std::vector<NodeId>>& node) {
-          std::vector<NodeId> neighbors;
-          neighbors.reserve(node.second.size());
-          for (NodeId id : node.second) {
-            if (id > node.first) {
-              neighbors.push_back(id);
-            }
-          }
-          std::sort(neighbors.begin(), neighbors.end());
-          return neighbors;
-        })
-      .WriteBinary(output);
   });
 }
-
@@ -96,6 +96,9 @@ int main(int argc, char const *argv[]) {
     run_and_log_partitioned_louvain([&](std::vector<uint32_t>& partitions) {
       return Partitioning::deterministicGreedyWithLinearPenalty(graph, i, partitions);
     });
+    run_and_log_partitioned_louvain([&](std::vector<uint32_t>& partitions) {
+      return Partitioning::fennel(graph, i, partitions);
+    });
     // run_and_log_partitioned_louvain([&](std::vector<uint32_t>& partitions) {
     //   return Partitioning::deterministicGreedyWithLinearPenalty(graph, i, partitions, true);
     // });
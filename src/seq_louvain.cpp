@@ -24,16 +24,25 @@ int main(int argc, char const *argv[]) {
   }
 
   Modularity::rng = std::default_random_engine(input.getSeed());
+  MapEq::rng = std::default_random_engine(input.getSeed());
   const Graph& graph = input.getGraph();
 
   ClusterStore clusters(graph.getNodeCount());
 
   Logging::Id algo_run_logging_id = Logging::getUnusedId();
   Logging::report("algorithm_run", algo_run_logging_id, "program_run_id", run_id);
+#if defined(MAP_EQ)
+  Logging::report("algorithm_run", algo_run_logging_id, "algorithm", "sequential louvain with map equation");
+#else
   Logging::report("algorithm_run", algo_run_logging_id, "algorithm", "sequential louvain");
+#endif
 
   thrill::common::StatsTimerBase<true> timer(/* autostart */ true);
+#if defined(MAP_EQ)
+  Louvain::louvainMapEq(graph, clusters, algo_run_logging_id);
+#else
   Louvain::louvainModularity(graph, clusters, algo_run_logging_id);
+#endif
   Logging::report("algorithm_run", algo_run_logging_id, "runtime", timer.Microseconds() / 1000000.0);
 
   Logging::Id cluster_logging_id = Louvain::log_clustering(graph, clusters);
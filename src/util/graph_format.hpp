@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <thrill/vfs/file_io.hpp>
+
+// Recognizes graph inputs with edge weights:
+// DIMACS (METIS) graphs whose header has an fmt field ending in 1, lines then alternate neighbors and weights,
+// edge lists with a weight as third column, and binary graphs written by preprocess with WEIGHTED=1 (*.weighted.bin).
+namespace GraphFormat {
+
+bool endsWith(const std::string& value, const std::string& ending) {
+  return ending.size() <= value.size() && std::equal(ending.rbegin(), ending.rend(), value.rbegin());
+}
+
+bool isWeightedBin(const std::string& path) {
+  return endsWith(path, ".weighted.bin") || endsWith(path, ".weighted.sym.bin");
+}
+
+// fmt field of a DIMACS header, "001" or "1" for edge weights, node weights are not supported
+bool isWeightedDimacsHeader(const std::string& header) {
+  std::istringstream header_stream(header);
+  uint64_t node_count, edge_count;
+  std::string fmt;
+  if (!(header_stream >> node_count >> edge_count >> fmt)) {
+    return false;
+  }
+  if (fmt.size() >= 2 && fmt[fmt.size() - 2] == '1') {
+    throw std::runtime_error("node weights are not supported");
+  }
+  return fmt.back() == '1';
+}
+
+// first line which is not a comment of the first file matching the glob
+std::string firstLine(const std::string& glob) {
+  thrill::vfs::FileList files = thrill::vfs::Glob(std::vector<std::string>(1, glob), thrill::vfs::GlobType::File);
+  std::string line;
+  if (files.size() > 0) {
+    std::ifstream file(files[0].path);
+    while (std::getline(file, line) && (line.empty() || line[0] == '#' || line[0] == '%')) {}
+  }
+  return line;
+}
+
+bool isWeightedDimacs(const std::string& path) {
+  return isWeightedDimacsHeader(firstLine(path));
+}
+
+bool isWeightedEdgeList(const std::string& path) {
+  std::istringstream line_stream(firstLine(path));
+  uint64_t tail, head, weight;
+  return bool(line_stream >> tail >> head >> weight);
+}
+
+bool isWeighted(const std::string& path) {
+  if (isWeightedBin(path)) {
+    return true;
+  } else if (endsWith(path, ".graph")) {
+    return isWeightedDimacs(path);
+  } else if (endsWith(path, ".txt")) {
+    return isWeightedEdgeList(path);
+  }
+  return false;
+}
+
+} // GraphFormat
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "data/graph.hpp"
+#include "data/cluster_store.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Synthetic graphs for benchmarks and scaling experiments.
+// Every node draws a share of the edges from its own random engine seeded by the graph seed and the node id,
+// so the same graph is generated regardless of the order or the worker in which nodes are processed.
+// Drawn edges may contain duplicates, adjacencyLists() and the thrill source remove them.
+namespace GraphGenerator {
+
+using NodeId = typename Graph::NodeId;
+using EdgeId = typename Graph::EdgeId;
+using ClusterId = typename ClusterStore::ClusterId;
+
+std::mt19937_64 nodeRng(const uint64_t seed, const NodeId node) {
+  std::seed_seq seq { uint32_t(seed), uint32_t(seed >> 32), uint32_t(node) };
+  return std::mt19937_64(seq);
+}
+
+// Continuous power law with the given exponent on [min, max] by inverse transform sampling
+template<class Rng>
+double powerLaw(Rng& rng, const double min, const double max, const double exponent) {
+  const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+  if (min == max) {
+    return min;
+  }
+  if (exponent == 1) {
+    return min * std::pow(max / min, u);
+  }
+  const double min_power = std::pow(min, 1 - exponent);
+  const double max_power = std::pow(max, 1 - exponent);
+  return std::pow(min_power + u * (max_power - min_power), 1 / (1 - exponent));
+}
+
+// Rounds x up or down at random such that the expectation is x
+template<class Rng>
+uint64_t roundRandomly(Rng& rng, const double x) {
+  uint64_t result = x;
+  if (std::uniform_real_distribution<double>(0, 1)(rng) < x - result) {
+    result++;
+  }
+  return result;
+}
+
+// G(n, m) like random graph: every node draws average_degree / 2 edges to uniformly random nodes
+struct ErdosRenyi {
+  NodeId node_count;
+  double average_degree;
+  uint64_t seed;
+
+  template<class F>
+  void forEachEdgeDrawnBy(const NodeId node, const F& f) const {
+    std::mt19937_64 rng = nodeRng(seed, node);
+    std::uniform_int_distribution<NodeId> any_node(0, node_count - 1);
+    for (uint64_t i = roundRandomly(rng, average_degree / 2); i > 0; i--) {
+      const NodeId neighbor = any_node(rng);
+      if (neighbor != node) {
+        f(node, neighbor);
+      }
+    }
+  }
+};
+
+// R-MAT with 2^scale nodes and edge_factor * 2^scale drawn edges, edge_factor per node.
+// Node ids are scrambled with a bijection so that the high degree nodes are not all at the front.
+struct RMat {
+  NodeId node_count;
+  uint32_t scale;
+  double edge_factor;
+  double a, b, c;
+  uint64_t seed;
+
+  RMat(const uint32_t scale, const double edge_factor, const double a, const double b, const double c, const uint64_t seed) :
+    node_count(NodeId(1) << scale), scale(scale), edge_factor(edge_factor), a(a), b(b), c(c), seed(seed) {
+    assert(scale < 32);
+    assert(a + b + c <= 1);
+  }
+
+  NodeId scramble(const NodeId node) const {
+    const uint64_t mask = node_count - 1;
+    uint64_t x = node;
+    x = (x * 0x9E3779B97F4A7C15ull) & mask;
+    x ^= x >> (scale / 2 + 1);
+    x = (x * 0xBF58476D1CE4E5B9ull) & mask;
+    return NodeId(x);
+  }
+
+  template<class F>
+  void forEachEdgeDrawnBy(const NodeId node, const F& f) const {
+    std::mt19937_64 rng = nodeRng(seed, node);
+    std::uniform_real_distribution<double> coin(0, 1);
+    for (uint64_t i = roundRandomly(rng, edge_factor); i > 0; i--) {
+      NodeId tail = 0, head = 0;
+      for (uint32_t bit = 0; bit < scale; bit++) {
+        const double r = coin(rng);
+        tail <<= 1;
+        head <<= 1;
+        if (r >= a + b + c) {
+          tail |= 1;
+          head |= 1;
+        } else if (r >= a + b) {
+          tail |= 1;
+        } else if (r >= a) {
+          head |= 1;
+        }
+      }
+      if (tail != head) {
+        f(scramble(tail), scramble(head));
+      }
+    }
+  }
+};
+
+// LFR like planted partition: cluster sizes and node degrees follow power laws.
+// Consecutive blocks of nodes form the ground truth clusters.
+// Each node draws half of its degree as edges, a fraction of mixing of them to random nodes
+// of the whole graph and the rest to random nodes of its own cluster.
+class PlantedPartition {
+public:
+
+  NodeId node_count;
+
+private:
+
+  NodeId min_degree, max_degree;
+  double degree_exponent;
+  double mixing;
+  uint64_t seed;
+  std::vector<NodeId> cluster_begins;
+
+public:
+
+  PlantedPartition(const NodeId node_count, const NodeId min_cluster_size, const NodeId max_cluster_size, const double cluster_size_exponent,
+                   const NodeId min_degree, const NodeId max_degree, const double degree_exponent, const double mixing, const uint64_t seed) :
+    node_count(node_count), min_degree(min_degree), max_degree(max_degree), degree_exponent(degree_exponent), mixing(mixing), seed(seed) {
+    assert(min_cluster_size > 0 && min_cluster_size <= max_cluster_size);
+    assert(min_degree <= max_degree);
+
+    std::mt19937_64 rng(seed);
+    NodeId begin = 0;
+    while (begin < node_count) {
+      cluster_begins.push_back(begin);
+      begin += std::min<NodeId>(node_count - begin, std::round(powerLaw(rng, min_cluster_size, max_cluster_size, cluster_size_exponent)));
+    }
+    cluster_begins.push_back(node_count);
+  }
+
+  // constant cluster size and degree
+  PlantedPartition(const NodeId node_count, const NodeId cluster_size, const NodeId degree, const double mixing, const uint64_t seed) :
+    PlantedPartition(node_count, cluster_size, cluster_size, 1, degree, degree, 2, mixing, seed) {}
+
+  ClusterId clusterOf(const NodeId node) const {
+    return std::upper_bound(cluster_begins.begin(), cluster_begins.end(), node) - cluster_begins.begin() - 1;
+  }
+
+  ClusterId clusterCount() const { return cluster_begins.size() - 1; }
+
+  template<class F>
+  void forEachEdgeDrawnBy(const NodeId node, const F& f) const {
+    std::mt19937_64 rng = nodeRng(seed, node);
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::uniform_int_distribution<NodeId> any_node(0, node_count - 1);
+
+    const ClusterId cluster = clusterOf(node);
+    const NodeId cluster_begin = cluster_begins[cluster];
+    const NodeId cluster_end = cluster_begins[cluster + 1];
+    std::uniform_int_distribution<NodeId> cluster_node(cluster_begin, cluster_end - 1);
+
+    const double degree = powerLaw(rng, min_degree, max_degree, degree_exponent);
+    for (uint64_t i = roundRandomly(rng, degree / 2); i > 0; i--) {
+      const NodeId neighbor = coin(rng) < mixing || cluster_end - cluster_begin < 2 ? any_node(rng) : cluster_node(rng);
+      if (neighbor != node) {
+        f(node, neighbor);
+      }
+    }
+  }
+
+  void groundTruth(ClusterStore& clusters) const {
+    assert(clusters.size() == node_count);
+    for (ClusterId cluster = 0; cluster < clusterCount(); cluster++) {
+      for (NodeId node = cluster_begins[cluster]; node < cluster_begins[cluster + 1]; node++) {
+        clusters.set(node, cluster);
+      }
+    }
+  }
+};
+
+// Symmetric, duplicate free adjacency lists as consumed by Graph::setEdgesByAdjacencyLists
+template<class Generator>
+EdgeId adjacencyLists(const Generator& generator, std::vector<std::vector<NodeId>>& neighbors) {
+  neighbors.clear();
+  neighbors.resize(generator.node_count);
+  for (NodeId node = 0; node < generator.node_count; node++) {
+    generator.forEachEdgeDrawnBy(node, [&neighbors](const NodeId tail, const NodeId head) {
+      neighbors[tail].push_back(head);
+      neighbors[head].push_back(tail);
+    });
+  }
+
+  EdgeId edge_count = 0;
+  for (auto& node_neighbors : neighbors) {
+    std::sort(node_neighbors.begin(), node_neighbors.end());
+    node_neighbors.erase(std::unique(node_neighbors.begin(), node_neighbors.end()), node_neighbors.end());
+    edge_count += node_neighbors.size();
+  }
+  return edge_count / 2;
+}
+
+template<class Generator>
+Graph generate(const Generator& generator) {
+  std::vector<std::vector<NodeId>> neighbors;
+  const EdgeId edge_count = adjacencyLists(generator, neighbors);
+  Graph graph(generator.node_count, edge_count);
+  graph.setEdgesByAdjacencyLists(neighbors);
+  return graph;
+}
+
+// Generator specifications of the form "<model>:key=value,key=value", e.g.
+// "rmat:scale=20,edge_factor=16", "er:n=1000000,degree=16" or
+// "lfr:n=1000000,min_cluster=20,max_cluster=1000,min_degree=10,max_degree=100,mixing=0.4".
+// Omitted keys take the defaults below, seed defaults to 42.
+class Spec {
+private:
+
+  std::string model;
+  std::map<std::string, std::string> values;
+
+public:
+
+  Spec(const std::string& spec) {
+    const size_t colon = spec.find(':');
+    model = spec.substr(0, colon);
+    if (colon != std::string::npos) {
+      std::istringstream stream(spec.substr(colon + 1));
+      std::string pair;
+      while (std::getline(stream, pair, ',')) {
+        const size_t equals = pair.find('=');
+        if (equals == std::string::npos) {
+          throw std::invalid_argument("malformed generator parameter " + pair);
+        }
+        values[pair.substr(0, equals)] = pair.substr(equals + 1);
+      }
+    }
+  }
+
+  const std::string& getModel() const { return model; }
+
+  double get(const std::string& key, const double default_value) const {
+    const auto it = values.find(key);
+    return it == values.end() ? default_value : std::stod(it->second);
+  }
+
+  PlantedPartition plantedPartition() const {
+    if (model != "lfr") {
+      throw std::invalid_argument("only lfr graphs have a ground truth");
+    }
+    return PlantedPartition(get("n", 1 << 20), get("min_cluster", 20), get("max_cluster", 1000), get("cluster_exponent", 1),
+                            get("min_degree", 10), get("max_degree", 100), get("degree_exponent", 2), get("mixing", 0.3), get("seed", 42));
+  }
+
+  // calls f with the generator described by the spec
+  template<class F>
+  auto withGenerator(const F& f) const {
+    const uint64_t seed = get("seed", 42);
+    if (model == "rmat") {
+      return f(RMat(get("scale", 20), get("edge_factor", 16), get("a", 0.57), get("b", 0.19), get("c", 0.19), seed));
+    } else if (model == "er") {
+      return f(ErdosRenyi { NodeId(get("n", 1 << 20)), get("degree", 16), seed });
+    } else if (model == "lfr") {
+      return f(plantedPartition());
+    } else {
+      throw std::invalid_argument("unknown graph generator " + model);
+    }
+  }
+};
+
+} // GraphGenerator
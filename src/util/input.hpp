@@ -38,22 +38,15 @@ public:
   Input(int argc, char const *argv[], Logging::Id run_id) :
     run_id(run_id),
     seed(std::chrono::system_clock::now().time_since_epoch().count()) {
-
     tlx::CmdlineParser cp;
+    parseArguments(argc, argv, cp);
+  }
 
-    cp.add_string('g', "ground-proof", "file", ground_proof_file, "A ground proof clustering to compare to");
-    cp.add_string('o', "output", "file", output_file, "The file to write the clustering to");
-    cp.add_unsigned('s', "seed", "unsigned int", seed, "Fix random seed");
-    cp.add_flag('f', "snap-format", "bool", snap_format, "Graph is in SNAP Edge List Format rather than DIMACS graph");
-    cp.add_flag('b', "binary-format", "bool", binary_format, "Graph is in Thrill binary format rather than DIMACS graph");
-    cp.add_param_string("graph", graph_file, "The graph to perform clustering on, in metis format");
-    cp.add_opt_param_stringlist("partitions", partitions_strings, "Partition with reporting UUID (comma seperated)");
-
-    if (!cp.process(argc, argv)) {
-      exit = 1;
-    }
-
-    Logging::report("program_run", run_id, "binary", argv[0]);
+  // cp may carry additional options of the binary
+  Input(int argc, char const *argv[], Logging::Id run_id, tlx::CmdlineParser& cp) :
+    run_id(run_id),
+    seed(std::chrono::system_clock::now().time_since_epoch().count()) {
+    parseArguments(argc, argv, cp);
   }
 
   void initialize() {
@@ -61,19 +54,33 @@ public:
       exit = 1;
       return;
     }
-    std::vector<std::vector<Graph::NodeId>> neighbors;
-    Graph::EdgeId edge_count = 0;
-    if (snap_format) {
-      establishIdMapping(graph_file);
-      neighbors.resize(id_mapping.size());
-      edge_count = IO::read_graph_txt(graph_file, neighbors, id_mapping);
-    } else if (binary_format) {
-      edge_count = IO::read_graph_bin(graph_file, neighbors);
+    if (binary_format) {
+      graph = std::make_unique<Graph>(IO::read_graph_bin_parallel(graph_file));
+    } else if (snap_format ? GraphFormat::isWeightedEdgeList(graph_file) : GraphFormat::isWeightedDimacs(graph_file)) {
+      std::vector<std::map<Graph::NodeId, Graph::Weight>> adjacency;
+      Graph::EdgeId edge_count = 0;
+      if (snap_format) {
+        establishIdMapping(graph_file);
+        adjacency.resize(id_mapping.size());
+        edge_count = IO::read_weighted_graph_txt(graph_file, adjacency, id_mapping);
+      } else {
+        edge_count = IO::read_weighted_graph(graph_file, adjacency);
+      }
+      graph = std::make_unique<Graph>(adjacency.size(), edge_count, true);
+      graph->setEdgesByAdjacencyMatrix(adjacency);
     } else {
-      edge_count = IO::read_graph(graph_file, neighbors);
+      std::vector<std::vector<Graph::NodeId>> neighbors;
+      Graph::EdgeId edge_count = 0;
+      if (snap_format) {
+        establishIdMapping(graph_file);
+        neighbors.resize(id_mapping.size());
+        edge_count = IO::read_graph_txt(graph_file, neighbors, id_mapping);
+      } else {
+        edge_count = IO::read_graph(graph_file, neighbors);
+      }
+      graph = std::make_unique<Graph>(neighbors.size(), edge_count);
+      graph->setEdgesByAdjacencyLists(neighbors);
     }
-    graph = std::make_unique<Graph>(neighbors.size(), edge_count);
-    graph->setEdgesByAdjacencyLists(neighbors);
 
 
     Logging::report("program_run", run_id, "graph", graph_file);
@@ -115,6 +122,22 @@ public:
 
 private:
 
+  void parseArguments(int argc, char const *argv[], tlx::CmdlineParser& cp) {
+    cp.add_string('g', "ground-proof", "file", ground_proof_file, "A ground proof clustering to compare to");
+    cp.add_string('o', "output", "file", output_file, "The file to write the clustering to");
+    cp.add_unsigned('s', "seed", "unsigned int", seed, "Fix random seed");
+    cp.add_flag('f', "snap-format", "bool", snap_format, "Graph is in SNAP Edge List Format rather than DIMACS graph");
+    cp.add_flag('b', "binary-format", "bool", binary_format, "Graph is in Thrill binary format rather than DIMACS graph");
+    cp.add_param_string("graph", graph_file, "The graph to perform clustering on, in metis format");
+    cp.add_opt_param_stringlist("partitions", partitions_strings, "Partition with reporting UUID (comma seperated)");
+
+    if (!cp.process(argc, argv)) {
+      exit = 1;
+    }
+
+    Logging::report("program_run", run_id, "binary", argv[0]);
+  }
+
   void establishIdMapping(const std::string& graph_file) {
     std::set<NodeId> node_ids;
     IO::open_file(graph_file, [&](auto& file) {
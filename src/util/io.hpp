@@ -2,13 +2,25 @@
 
 #include "data/graph.hpp"
 #include "data/cluster_store.hpp"
+#include "util/graph_format.hpp"
 
 #include <assert.h>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <sstream>
 #include <fstream>
 #include <iostream>
 #include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <numeric>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <thrill/vfs/file_io.hpp>
 
@@ -71,6 +83,53 @@ Graph::EdgeId read_graph_txt(const std::string& filename, std::vector<std::vecto
   return edge_count;
 }
 
+// DIMACS graph with edge weights, every line alternates neighbors and weights. Parallel edges are merged.
+Graph::EdgeId read_weighted_graph(const std::string& filename, std::vector<std::map<Graph::NodeId, Graph::Weight>> &adjacency) {
+  Graph::EdgeId edge_count;
+  open_file(filename, [&](auto& file) {
+    std::string line;
+    Graph::NodeId node_count;
+    std::getline(file, line);
+    std::istringstream header_stream(line);
+    header_stream >> node_count >> edge_count;
+    adjacency.resize(node_count);
+
+    Graph::NodeId i = 0;
+    while (std::getline(file, line)) {
+      std::istringstream line_stream(line);
+      Graph::NodeId neighbor;
+      Graph::Weight weight;
+      while (line_stream >> neighbor >> weight) {
+        adjacency[i][neighbor - 1] += weight;
+      }
+      i++;
+    }
+  });
+  return edge_count;
+}
+
+// Edge list with the weight as third column, parallel edges are merged
+Graph::EdgeId read_weighted_graph_txt(const std::string& filename, std::vector<std::map<Graph::NodeId, Graph::Weight>> &adjacency, std::unordered_map<Graph::NodeId, Graph::NodeId>& id_mapping) {
+  Graph::EdgeId edge_count = 0;
+  open_file(filename, [&](auto& file) {
+    std::string line;
+
+    while (std::getline(file, line)) {
+      if (!line.empty() && line[0] != '#') {
+        std::istringstream line_stream(line);
+        Graph::NodeId tail, head;
+        Graph::Weight weight;
+        if (line_stream >> tail >> head >> weight) {
+          adjacency[id_mapping[tail]][id_mapping[head]] += weight;
+          adjacency[id_mapping[head]][id_mapping[tail]] += weight;
+        }
+        edge_count++;
+      }
+    }
+  });
+  return edge_count;
+}
+
 template <typename stream_t>
 uint64_t GetVarint(stream_t &is) {
   auto get_byte = [&is]() -> uint8_t {
@@ -104,50 +163,122 @@ uint64_t GetVarint(stream_t &is) {
   return v;
 }
 
-Graph::EdgeId read_graph_bin(const thrill::vfs::FileList& paths, std::vector<std::vector<Graph::NodeId>> &neighbors) {
-  Graph::EdgeId edge_count = 0;
+// Varint at pos, which is advanced past it. Most degrees fit into the first byte.
+inline uint64_t decodeVarint(const uint8_t*& pos, const uint8_t* end) {
+  if (pos < end && !(*pos & 0x80)) {
+    return *pos++;
+  }
+  uint64_t v = 0;
+  for (uint32_t shift = 0; shift < 64; shift += 7) {
+    if (pos >= end) {
+      throw std::runtime_error("Unexpected end of file during varint decoding.");
+    }
+    const uint64_t u = *pos++;
+    if (shift == 63 && (u & 0xFE)) {
+      throw std::overflow_error("Overflow during varint64 decoding.");
+    }
+    v |= (u & 0x7F) << shift;
+    if (!(u & 0x80)) {
+      return v;
+    }
+  }
+  return v;
+}
 
-  assert(neighbors.empty());
+// Read only memory mapping of a whole file
+class MappedFile {
+private:
+
+  const uint8_t* data = nullptr;
+  size_t length = 0;
 
-  if (!paths.empty()) {
-    std::ifstream is;
-    size_t _file_index = 0;
+public:
 
-    auto next_input = [&]() {
-      is.close();
-      if (_file_index < paths.size()) {
-        is.open(paths[_file_index++].path);
+  MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Could not open file " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Could not stat file " + path);
+    }
+    length = file_stat.st_size;
+    if (length > 0) {
+      void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Could not map file " + path);
       }
-    };
+      madvise(mapping, length, MADV_SEQUENTIAL);
+      data = static_cast<const uint8_t*>(mapping);
+    }
+    ::close(fd);
+  }
 
-    next_input();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
 
-    for (NodeId u = 0; is.good() && is.is_open(); ++u) {
-      // Add node if it does not exist yet, only one may be missing
-      if (u >= neighbors.size()) {
-        neighbors.emplace_back();
-      }
+  ~MappedFile() {
+    if (data) {
+      munmap(const_cast<uint8_t*>(data), length);
+    }
+  }
 
-      for (size_t deg = GetVarint(is); deg > 0 && is.good(); --deg) {
-        uint32_t v;
-        if (!is.read(reinterpret_cast<char*>(&v), 4)) {
-          throw std::runtime_error("I/O error while reading next neighbor");
-        }
+  const uint8_t* begin() const { return data; }
+  const uint8_t* end() const { return data + length; }
+};
 
-        assert(u != v);
-        neighbors[u].push_back(v);
-        if (v >= neighbors.size()) {
-          neighbors.resize(v + 1);
-        }
-        neighbors[v].push_back(u);
-        edge_count++;
+// Calls f(node, neighbors, degree) for every node of the thrill binary graph files, in order.
+// Each node is stored as a varint degree followed by its neighbors as raw 32 bit ids, the neighbors
+// are copied in one go into a buffer which stays valid until the next call.
+template<class F>
+void forEachBinNode(const thrill::vfs::FileList& paths, const F& f) {
+  static_assert(std::is_same<uint32_t, NodeId>::value, "binary graph format stores 32 bit node ids");
+  std::vector<NodeId> buffer;
+  NodeId u = 0;
+
+  for (const auto& path : paths) {
+    MappedFile file(path.path);
+    const uint8_t* pos = file.begin();
+    while (pos < file.end()) {
+      const size_t degree = decodeVarint(pos, file.end());
+      if (size_t(file.end() - pos) < degree * sizeof(NodeId)) {
+        throw std::runtime_error("I/O error while reading next neighbor");
       }
+      buffer.resize(degree);
+      std::memcpy(buffer.data(), pos, degree * sizeof(NodeId));
+      pos += degree * sizeof(NodeId);
 
-      if (is.is_open() && (is.peek() == std::char_traits<char>::eof() || !is.good())) {
-        next_input();
-      }
+      f(u, static_cast<const NodeId*>(buffer.data()), degree);
+      ++u;
     }
   }
+}
+
+Graph::EdgeId read_graph_bin(const thrill::vfs::FileList& paths, std::vector<std::vector<Graph::NodeId>> &neighbors) {
+  Graph::EdgeId edge_count = 0;
+
+  assert(neighbors.empty());
+
+  forEachBinNode(paths, [&](const NodeId u, const NodeId* node_neighbors, const size_t degree) {
+    // Add node if it does not exist yet, only one may be missing
+    if (u >= neighbors.size()) {
+      neighbors.emplace_back();
+    }
+
+    neighbors[u].insert(neighbors[u].end(), node_neighbors, node_neighbors + degree);
+    for (size_t i = 0; i < degree; i++) {
+      const NodeId v = node_neighbors[i];
+      assert(u != v);
+      if (v >= neighbors.size()) {
+        neighbors.resize(v + 1);
+      }
+      neighbors[v].push_back(u);
+    }
+    edge_count += degree;
+  });
 
   return edge_count;
 };
@@ -157,40 +288,205 @@ Graph::EdgeId read_graph_bin(const std::string& glob, std::vector<std::vector<Gr
   return read_graph_bin(files, neighbors);
 };
 
-template<typename F>
-void stream_bin_graph(const std::string& glob, const F& f) {
-  thrill::vfs::FileList paths = thrill::vfs::Glob(std::vector<std::string>(1, glob), thrill::vfs::GlobType::File);
+// Binary graphs written by preprocess with SYMMETRIC=1 store every link at both of its nodes
+bool is_symmetric_bin(const std::string& path) {
+  return GraphFormat::endsWith(path, ".sym.bin");
+}
+
+// Loads all shards of a binary graph concurrently into the symmetric CSR of a Graph.
+// A scan over the degrees finds the node range of every shard and cuts it into chunks,
+// then the chunks are decoded in parallel twice, once to count degrees and once to place the links.
+// Adjacency arrays are sorted afterwards, which yields the same graph as read_graph_bin on preprocessed input.
+// Symmetric files already contain both directions, so only the stored ones are placed.
+// Weighted files store the neighbors of a node followed by a vector of their weights and yield a weighted Graph.
+Graph read_graph_bin_parallel(const thrill::vfs::FileList& paths, const bool symmetric = false, const bool weighted = false) {
+  struct Chunk {
+    size_t shard;
+    const uint8_t* begin;
+    const uint8_t* end;
+    NodeId first_node;
+  };
+  constexpr NodeId chunk_nodes = 1 << 16;
 
-  if (!paths.empty()) {
-    std::ifstream is;
-    size_t _file_index = 0;
+  std::vector<std::unique_ptr<MappedFile>> files;
+  for (const auto& path : paths) {
+    files.push_back(std::make_unique<MappedFile>(path.path));
+  }
 
-    auto next_input = [&]() {
-      is.close();
-      if (_file_index < paths.size()) {
-        is.open(paths[_file_index++].path);
+  std::vector<std::vector<Chunk>> shard_chunks(files.size());
+  std::vector<NodeId> shard_first_node(files.size() + 1, 0);
+  std::atomic<bool> truncated(false);
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (size_t shard = 0; shard < files.size(); shard++) {
+    const uint8_t* pos = files[shard]->begin();
+    const uint8_t* end = files[shard]->end();
+    NodeId node = 0;
+    while (pos < end) {
+      if (node % chunk_nodes == 0) {
+        shard_chunks[shard].push_back(Chunk { shard, pos, end, node });
       }
-    };
+      const uint64_t degree = decodeVarint(pos, end);
+      if (uint64_t(end - pos) < degree * sizeof(NodeId)) {
+        truncated = true;
+        break;
+      }
+      pos += degree * sizeof(NodeId);
+      if (weighted) {
+        if (pos >= end || decodeVarint(pos, end) != degree || uint64_t(end - pos) < degree * sizeof(Weight)) {
+          truncated = true;
+          break;
+        }
+        pos += degree * sizeof(Weight);
+      }
+      node++;
+    }
+    for (size_t i = 0; i + 1 < shard_chunks[shard].size(); i++) {
+      shard_chunks[shard][i].end = shard_chunks[shard][i + 1].begin;
+    }
+    shard_first_node[shard + 1] = node;
+  }
+  if (truncated) {
+    throw std::runtime_error("I/O error while reading next neighbor");
+  }
+  std::partial_sum(shard_first_node.begin(), shard_first_node.end(), shard_first_node.begin());
+  const NodeId node_count = shard_first_node.back();
+
+  std::vector<Chunk> chunks;
+  for (const auto& chunks_of_shard : shard_chunks) {
+    for (Chunk chunk : chunks_of_shard) {
+      chunk.first_node += shard_first_node[chunk.shard];
+      chunks.push_back(chunk);
+    }
+  }
+
+  auto for_each_link = [&chunks, weighted](const size_t chunk, const auto& f) {
+    const uint8_t* pos = chunks[chunk].begin;
+    for (NodeId u = chunks[chunk].first_node; pos < chunks[chunk].end; u++) {
+      const uint64_t degree = decodeVarint(pos, chunks[chunk].end);
+      const uint8_t* weight_pos = pos + degree * sizeof(NodeId);
+      if (weighted) {
+        decodeVarint(weight_pos, chunks[chunk].end);
+      }
+      for (uint64_t i = 0; i < degree; i++) {
+        NodeId v;
+        Weight w = 1;
+        std::memcpy(&v, pos + i * sizeof(NodeId), sizeof(NodeId));
+        if (weighted) {
+          std::memcpy(&w, weight_pos + i * sizeof(Weight), sizeof(Weight));
+        }
+        f(u, v, w);
+      }
+      pos = weighted ? weight_pos + degree * sizeof(Weight) : weight_pos;
+    }
+  };
 
-    next_input();
+  std::vector<std::atomic<Graph::EdgeId>> cursors(node_count);
+  std::atomic<bool> invalid_neighbor(false);
+  #pragma omp parallel
+  {
+    #pragma omp for schedule(static)
+    for (NodeId node = 0; node < node_count; node++) {
+      cursors[node].store(0, std::memory_order_relaxed);
+    }
 
-    for (NodeId u = 0; is.good() && is.is_open(); ++u) {
-      for (size_t deg = GetVarint(is); deg > 0 && is.good(); --deg) {
-        uint32_t v;
-        if (!is.read(reinterpret_cast<char*>(&v), 4)) {
-          throw std::runtime_error("I/O error while reading next neighbor");
+    #pragma omp for schedule(dynamic, 1)
+    for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+      for_each_link(chunk, [&](const NodeId u, const NodeId v, const Weight) {
+        if (v >= node_count) {
+          invalid_neighbor.store(true, std::memory_order_relaxed);
+          return;
+        }
+        cursors[u].fetch_add(1, std::memory_order_relaxed);
+        if (!symmetric) {
+          cursors[v].fetch_add(1, std::memory_order_relaxed);
         }
+      });
+    }
+  }
+  if (invalid_neighbor) {
+    throw std::runtime_error("Neighbor id out of range in binary graph");
+  }
+
+  std::vector<Graph::EdgeId> first_out(node_count + 1, 0);
+  for (NodeId node = 0; node < node_count; node++) {
+    first_out[node + 1] = first_out[node] + cursors[node].load(std::memory_order_relaxed);
+  }
+
+  std::vector<NodeId> neighbors(first_out.back());
+  std::vector<Weight> weights(weighted ? first_out.back() : 0);
+  #pragma omp parallel
+  {
+    #pragma omp for schedule(static)
+    for (NodeId node = 0; node < node_count; node++) {
+      cursors[node].store(first_out[node], std::memory_order_relaxed);
+    }
 
+    #pragma omp for schedule(dynamic, 1)
+    for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+      for_each_link(chunk, [&](const NodeId u, const NodeId v, const Weight w) {
         assert(u != v);
-        f(u, v);
-        f(v, u);
-      }
+        const Graph::EdgeId forward = cursors[u].fetch_add(1, std::memory_order_relaxed);
+        neighbors[forward] = v;
+        if (weighted) {
+          weights[forward] = w;
+        }
+        if (!symmetric) {
+          const Graph::EdgeId backward = cursors[v].fetch_add(1, std::memory_order_relaxed);
+          neighbors[backward] = u;
+          if (weighted) {
+            weights[backward] = w;
+          }
+        }
+      });
+    }
 
-      if (is.is_open() && (is.peek() == std::char_traits<char>::eof() || !is.good())) {
-        next_input();
+    if (weighted) {
+      std::vector<std::pair<NodeId, Weight>> links;
+      #pragma omp for schedule(dynamic, 1024)
+      for (NodeId node = 0; node < node_count; node++) {
+        links.clear();
+        for (Graph::EdgeId edge = first_out[node]; edge < first_out[node + 1]; edge++) {
+          links.emplace_back(neighbors[edge], weights[edge]);
+        }
+        std::sort(links.begin(), links.end());
+        for (Graph::EdgeId edge = first_out[node]; edge < first_out[node + 1]; edge++) {
+          neighbors[edge] = links[edge - first_out[node]].first;
+          weights[edge] = links[edge - first_out[node]].second;
+        }
+      }
+    } else {
+      #pragma omp for schedule(dynamic, 1024)
+      for (NodeId node = 0; node < node_count; node++) {
+        std::sort(neighbors.begin() + first_out[node], neighbors.begin() + first_out[node + 1]);
       }
     }
   }
+
+  if (weighted) {
+    return Graph(std::move(first_out), std::move(neighbors), std::move(weights));
+  }
+  return Graph(std::move(first_out), std::move(neighbors));
+}
+
+Graph read_graph_bin_parallel(const std::string& glob) {
+  return read_graph_bin_parallel(thrill::vfs::Glob(std::vector<std::string>(1, glob), thrill::vfs::GlobType::File), is_symmetric_bin(glob), GraphFormat::isWeightedBin(glob));
+}
+
+template<typename F>
+void stream_bin_nodes(const std::string& glob, const F& f) {
+  forEachBinNode(thrill::vfs::Glob(std::vector<std::string>(1, glob), thrill::vfs::GlobType::File), f);
+}
+
+template<typename F>
+void stream_bin_graph(const std::string& glob, const F& f) {
+  stream_bin_nodes(glob, [&f](const NodeId u, const NodeId* neighbors, const size_t degree) {
+    for (size_t i = 0; i < degree; i++) {
+      assert(u != neighbors[i]);
+      f(u, neighbors[i]);
+      f(neighbors[i], u);
+    }
+  });
 }
 
 void read_clustering(const std::string& filename, ClusterStore& clusters) {
@@ -253,6 +549,18 @@ void read_partition(const std::string& filename, std::vector<uint32_t>& node_par
   });
 }
 
+// one element id per line, the format read_partition expects
+void write_partition(const std::string& filename, const std::vector<uint32_t>& node_partition_elements) {
+  std::ofstream f(filename, std::ios::out);
+  if(!f.is_open()) {
+      throw std::runtime_error("Could not open file " + filename);
+  }
+
+  for (uint32_t element : node_partition_elements) {
+    f << element << '\n';
+  }
+}
+
 ClusterStore read_binary_clustering(const std::string& glob, const size_t num_nodes) {
   constexpr size_t width = sizeof(ClusterId);
 
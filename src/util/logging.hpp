@@ -1,11 +1,24 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <cstdint>
+#include <cstdlib>
 #include <vector>
+#include <string>
 #include <limits>
 #include <iomanip>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <csignal>
+#include <exception>
+#include <type_traits>
+#include <cmath>
+#include <unistd.h>
 
 #include "data/graph.hpp"
 #include "data/cluster_store.hpp"
@@ -19,23 +32,277 @@ typedef uint64_t Id;
 
 Id id_counter = 0;
 
-template<class IdType, class KeyType, class ValueType>
-void report(const std::string & type, const IdType id, const KeyType & key, const ValueType & value) {
-  std::cout << LOGGING_PREFIX << type << '/' << id << '/' << key << ": " << value << std::endl;
+// Records are formatted on the calling thread and appended to an in memory buffer.
+// A background thread writes the buffer out in batches, so reporting from inside hot loops
+// or from many workers does not flush stdout once per record.
+// LOGGING_SYNC=1 writes every record through immediately (useful when chasing crashes).
+// On exit, std::terminate and fatal signals the buffer is written out before the process ends,
+// records reported after that are written immediately.
+// LOGGING_JSON_FILE=path additionally writes one JSON object per record, %p in path is replaced by the pid.
+class Sink {
+private:
+
+  static constexpr size_t flush_threshold = 1 << 16;
+
+  // guards the buffers
+  std::mutex mutex;
+  // held from taking a batch out of the buffers until it is written, so batches go out in order
+  std::mutex write_mutex;
+  std::condition_variable wakeup;
+  std::string text_buffer;
+  std::string json_buffer;
+  std::ofstream json_out;
+  std::thread writer;
+  std::atomic<bool> synchronous;
+  bool stopped = false;
+
+  static Sink* instance;
+  static std::terminate_handler previous_terminate;
+
+public:
+
+  Sink() : synchronous(getenv("LOGGING_SYNC") != nullptr) {
+    if (getenv("LOGGING_JSON_FILE")) {
+      std::string path = getenv("LOGGING_JSON_FILE");
+      size_t pid_index = path.find("%p");
+      if (pid_index != std::string::npos) {
+        path.replace(pid_index, 2, std::to_string(getpid()));
+      }
+      json_out.open(path, std::ios::out | std::ios::app);
+      if (!json_out.is_open()) {
+        throw std::runtime_error("Could not open file " + path);
+      }
+    }
+
+    // a normal exit writes the rest in the destructor
+    instance = this;
+    previous_terminate = std::set_terminate([]() {
+      if (instance) {
+        instance->flushAfterCrash();
+      }
+      previous_terminate ? previous_terminate() : std::abort();
+    });
+    // signals somebody else already handles are left alone
+    for (const int signal : { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL, SIGTERM, SIGINT }) {
+      struct sigaction previous;
+      if (sigaction(signal, nullptr, &previous) == 0 && previous.sa_handler == SIG_DFL) {
+        std::signal(signal, [](const int signal) {
+          if (instance) {
+            instance->flushAfterCrash();
+          }
+          std::signal(signal, SIG_DFL);
+          std::raise(signal);
+        });
+      }
+    }
+  }
+
+  ~Sink() {
+    instance = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    wakeup.notify_one();
+    if (writer.joinable()) {
+      writer.join();
+    }
+    writeBuffered();
+  }
+
+  bool writesJson() const { return json_out.is_open(); }
+
+  void push(const std::string& text, const std::string& json) {
+    std::unique_lock<std::mutex> lock(mutex);
+    text_buffer += text;
+    if (json_out.is_open()) {
+      json_buffer += json;
+    }
+
+    if (synchronous) {
+      lock.unlock();
+      writeBuffered();
+    } else if (!writer.joinable()) {
+      writer = std::thread([this]() { run(); });
+    } else if (text_buffer.size() >= flush_threshold) {
+      lock.unlock();
+      wakeup.notify_one();
+    }
+  }
+
+  // returns once everything reported before, including a batch the writer thread is working on, is written
+  void flush() {
+    writeBuffered();
+  }
+
+  // Best effort from a terminate or signal handler: other threads may be stopped anywhere, possibly holding a lock,
+  // so locks are only waited for a moment. Everything reported afterwards is written immediately.
+  void flushAfterCrash() {
+    synchronous = true;
+    std::unique_lock<std::mutex> write_lock(write_mutex, std::defer_lock);
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (tryLockFor(write_lock) && tryLockFor(lock)) {
+      write(text_buffer, json_buffer);
+      text_buffer.clear();
+      json_buffer.clear();
+    }
+  }
+
+private:
+
+  static bool tryLockFor(std::unique_lock<std::mutex>& lock) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+      if (lock.try_lock()) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopped) {
+      wakeup.wait_for(lock, std::chrono::milliseconds(100), [this]() { return stopped || text_buffer.size() >= flush_threshold; });
+      lock.unlock();
+      writeBuffered();
+      lock.lock();
+    }
+  }
+
+  void writeBuffered() {
+    std::lock_guard<std::mutex> write_lock(write_mutex);
+    std::string text, json;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      text.swap(text_buffer);
+      json.swap(json_buffer);
+    }
+    write(text, json);
+  }
+
+  void write(const std::string& text, const std::string& json) {
+    if (!text.empty()) {
+      std::cout.write(text.data(), text.size());
+      std::cout.flush();
+    }
+    if (!json.empty()) {
+      json_out.write(json.data(), json.size());
+      json_out.flush();
+    }
+  }
+};
+
+Sink* Sink::instance = nullptr;
+std::terminate_handler Sink::previous_terminate = nullptr;
+
+Sink sink;
+
+void flush() {
+  sink.flush();
 }
 
-template<class IdType, class KeyType>
-void report(const std::string & type, const IdType id, const KeyType & key, const bool & value) {
-  std::cout << LOGGING_PREFIX << type << '/' << id << '/' << key << ": " << (value ? "true" : "false") << std::endl;
+template<class ValueType>
+void formatValue(std::ostream& os, const ValueType& value) {
+  os << value;
 }
 
-template<class IdType, class KeyType, class ValueType>
-void report(const std::string & type, const IdType id, const KeyType & key, const std::vector<ValueType> & values) {
-  std::cout << LOGGING_PREFIX << type << '/' << id << '/' << key << ": " << "[";
+void formatValue(std::ostream& os, const bool& value) {
+  os << (value ? "true" : "false");
+}
+
+template<class ValueType>
+void formatValue(std::ostream& os, const std::vector<ValueType>& values) {
+  os << "[";
   for (const ValueType& value : values) {
-    std::cout << value << ", ";
+    os << value << ", ";
   }
-  std::cout << "]" << std::endl;
+  os << "]";
+}
+
+void formatJsonString(std::ostream& os, const std::string& value) {
+  os << '"';
+  for (char c : value) {
+    switch (c) {
+      case '"': os << "\\\""; break;
+      case '\\': os << "\\\\"; break;
+      case '\n': os << "\\n"; break;
+      case '\t': os << "\\t"; break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+        } else {
+          os << c;
+        }
+    }
+  }
+  os << '"';
+}
+
+template<class ValueType>
+void formatJsonValue(std::ostream& os, const ValueType& value, std::true_type /* arithmetic */) {
+  if (std::isfinite(value)) {
+    os << value;
+  } else {
+    os << "null";
+  }
+}
+
+template<class ValueType>
+void formatJsonValue(std::ostream& os, const ValueType& value, std::false_type /* arithmetic */) {
+  std::ostringstream stringified;
+  stringified << value;
+  formatJsonString(os, stringified.str());
+}
+
+template<class ValueType>
+void formatJsonValue(std::ostream& os, const ValueType& value) {
+  formatJsonValue(os, value, std::integral_constant<bool, std::is_arithmetic<ValueType>::value>());
+}
+
+void formatJsonValue(std::ostream& os, const bool& value) {
+  os << (value ? "true" : "false");
+}
+
+template<class ValueType>
+void formatJsonValue(std::ostream& os, const std::vector<ValueType>& values) {
+  os << "[";
+  for (size_t i = 0; i < values.size(); i++) {
+    if (i > 0) {
+      os << ",";
+    }
+    formatJsonValue(os, values[i]);
+  }
+  os << "]";
+}
+
+template<class IdType, class KeyType, class ValueType>
+void report(const std::string & type, const IdType id, const KeyType & key, const ValueType & value) {
+  thread_local std::ostringstream text;
+  text.str("");
+  text << std::setprecision(std::numeric_limits<double>::max_digits10);
+  text << LOGGING_PREFIX << type << '/' << id << '/' << key << ": ";
+  formatValue(text, value);
+  text << '\n';
+
+  thread_local std::ostringstream json;
+  json.str("");
+  if (sink.writesJson()) {
+    std::ostringstream key_string;
+    key_string << key;
+    json << std::setprecision(std::numeric_limits<double>::max_digits10);
+    json << "{\"type\":";
+    formatJsonString(json, type);
+    json << ",\"id\":";
+    formatJsonValue(json, id);
+    json << ",\"key\":";
+    formatJsonString(json, key_string.str());
+    json << ",\"value\":";
+    formatJsonValue(json, value);
+    json << "}\n";
+  }
+
+  sink.push(text.str(), json.str());
 }
 
 Id getUnusedId() {
@@ -68,10 +335,7 @@ std::pair<std::string, std::string> parse_input_with_logging_id(const std::strin
 
 template<class IdType, class KeyType>
 void report_timestamp(const std::string & type, const IdType id, const KeyType & key) {
-  std::cout << LOGGING_PREFIX << type << '/' << id << '/' << key << ": "
-    << std::setprecision(std::numeric_limits<double>::max_digits10)
-    << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
-    << std::endl;
+  report(type, id, key, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
 }
 
 }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+// Resident set size of the process and (when compiled with COUNT_ALLOCATIONS)
+// the number and volume of heap allocations of the calling thread.
+namespace Memory {
+
+struct Allocations {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+
+  Allocations operator-(const Allocations& other) const {
+    return Allocations { count - other.count, bytes - other.bytes };
+  }
+};
+
+// plain counters without constructor so the allocation hook may touch them at any time
+thread_local uint64_t thread_allocation_count = 0;
+thread_local uint64_t thread_allocated_bytes = 0;
+
+constexpr bool countsAllocations() {
+#if defined(COUNT_ALLOCATIONS)
+  return true;
+#else
+  return false;
+#endif
+}
+
+Allocations threadAllocations() {
+  return Allocations { thread_allocation_count, thread_allocated_bytes };
+}
+
+// Returns the value of a "Key:   1234 kB" line of /proc/self/status in bytes, 0 if unavailable
+uint64_t procStatusBytes(const std::string& key) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':') {
+      return std::strtoull(line.c_str() + key.size() + 1, nullptr, 10) * 1024;
+    }
+  }
+  return 0;
+}
+
+uint64_t currentRSS() {
+  return procStatusBytes("VmRSS");
+}
+
+uint64_t peakRSS() {
+  return procStatusBytes("VmHWM");
+}
+
+// Resets the peak RSS to the current RSS so that peakRSS() covers only what follows (Linux >= 4.0)
+bool resetPeakRSS() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  return clear_refs.good();
+}
+
+} // Memory
+
+#if defined(COUNT_ALLOCATIONS)
+
+void* operator new(size_t size) {
+  Memory::thread_allocation_count++;
+  Memory::thread_allocated_bytes += size;
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  Memory::thread_allocation_count++;
+  Memory::thread_allocated_bytes += size;
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+#endif
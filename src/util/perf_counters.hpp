@@ -0,0 +1,177 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters of the calling thread through perf_event_open.
+// Disabled unless the PERF_COUNTERS environment variable is set.
+// When the counters are not available (kernel.perf_event_paranoid, no PMU in a VM, ...)
+// a warning is printed once and all samples are invalid.
+// Measurements on the same thread must not be nested.
+namespace PerfCounters {
+
+enum Event : uint8_t { Cycles, Instructions, LLCMisses, BranchMisses, EventCount };
+
+const char* const event_names[EventCount] = { "cycles", "instructions", "llc_misses", "branch_misses" };
+
+struct Sample {
+  bool valid = false;
+  std::array<uint64_t, EventCount> values {};
+
+  Sample& operator+=(const Sample& other) {
+    if (other.valid) {
+      valid = true;
+      for (uint8_t event = 0; event < EventCount; event++) {
+        values[event] += other.values[event];
+      }
+    }
+    return *this;
+  }
+};
+
+bool enabled() {
+  static const bool enabled = getenv("PERF_COUNTERS") != nullptr;
+  return enabled;
+}
+
+#if defined(__linux__)
+
+class Group {
+private:
+
+  std::array<int, EventCount> fds;
+  bool available = false;
+
+  static int open(const uint64_t config, const int group_fd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+  }
+
+public:
+
+  Group() {
+    fds.fill(-1);
+    const std::array<uint64_t, EventCount> configs = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    for (uint8_t event = 0; event < EventCount; event++) {
+      fds[event] = open(configs[event], fds[0]);
+      if (fds[event] == -1) {
+        static std::atomic<bool> warned(false);
+        if (!warned.exchange(true)) {
+          std::cerr << "perf_event_open failed for " << event_names[event] << ": " << strerror(errno) << ", hardware counters disabled" << std::endl;
+        }
+        close();
+        return;
+      }
+    }
+    available = true;
+  }
+
+  ~Group() { close(); }
+
+  Group(const Group&) = delete;
+  Group& operator=(const Group&) = delete;
+
+  bool isAvailable() const { return available; }
+
+  void start() {
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  Sample stop() {
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    struct {
+      uint64_t nr;
+      uint64_t time_enabled;
+      uint64_t time_running;
+      uint64_t values[EventCount];
+    } buffer;
+
+    Sample sample;
+    if (::read(fds[0], &buffer, sizeof(buffer)) != sizeof(buffer) || buffer.nr != EventCount || buffer.time_running == 0) {
+      return sample;
+    }
+
+    // scale in case the kernel had to multiplex the counters
+    const double scale = double(buffer.time_enabled) / buffer.time_running;
+    for (uint8_t event = 0; event < EventCount; event++) {
+      sample.values[event] = buffer.values[event] * scale;
+    }
+    sample.valid = true;
+    return sample;
+  }
+
+private:
+
+  void close() {
+    for (int& fd : fds) {
+      if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    available = false;
+  }
+};
+
+#else
+
+class Group {
+public:
+  bool isAvailable() const { return false; }
+  void start() {}
+  Sample stop() { return Sample(); }
+};
+
+#endif
+
+// Counts the calling thread from construction until stop()
+class Measurement {
+private:
+
+  Group* group = nullptr;
+
+public:
+
+  Measurement() {
+    if (enabled()) {
+      thread_local Group thread_group;
+      if (thread_group.isAvailable()) {
+        group = &thread_group;
+        group->start();
+      }
+    }
+  }
+
+  Sample stop() {
+    if (!group) {
+      return Sample();
+    }
+    Sample sample = group->stop();
+    group = nullptr;
+    return sample;
+  }
+};
+
+} // PerfCounters
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "util/logging.hpp"
+#include "util/memory.hpp"
+#include "util/perf_counters.hpp"
+
+namespace PhaseStats {
+
+enum Phase : uint8_t { LocalMoving, Contraction, LabelExchange, Evaluation, PhaseCount };
+enum Counter : uint8_t { Moves, CandidateClusters, EmittedRecords, GhostGraphBytes, CounterCount };
+
+const char* const phase_names[PhaseCount] = { "local_moving", "contraction", "label_exchange", "evaluation" };
+const char* const counter_names[CounterCount] = { "moves", "candidate_clusters", "emitted_records", "ghost_graph_bytes" };
+
+class Timer {
+private:
+
+  std::chrono::steady_clock::time_point start;
+
+public:
+
+  Timer() : start(std::chrono::steady_clock::now()) {}
+
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+struct Sample {
+  double seconds = 0;
+  Memory::Allocations allocations;
+  PerfCounters::Sample hardware_counters;
+};
+
+struct LevelRecord {
+  Logging::Id logging_id = 0;
+  std::array<double, PhaseCount> seconds {};
+  std::array<uint64_t, PhaseCount> rounds {};
+  std::array<uint64_t, CounterCount> counters {};
+  std::array<Memory::Allocations, PhaseCount> allocations {};
+  std::array<PerfCounters::Sample, PhaseCount> hardware_counters {};
+  uint64_t peak_rss = 0;
+
+  void add(const Phase phase, const Sample& sample) {
+    seconds[phase] += sample.seconds;
+    rounds[phase]++;
+    allocations[phase].count += sample.allocations.count;
+    allocations[phase].bytes += sample.allocations.bytes;
+    hardware_counters[phase] += sample.hardware_counters;
+  }
+
+  void notePeakRSS() {
+    peak_rss = std::max(peak_rss, Memory::peakRSS());
+  }
+
+  // Report the values of a single worker, as done by the sequential algorithms
+  template<class IdType>
+  void report(const std::string& type, const IdType id) const {
+    for (uint8_t phase = 0; phase < PhaseCount; phase++) {
+      if (rounds[phase] > 0) {
+        Logging::report(type, id, std::string(phase_names[phase]) + "_time", seconds[phase]);
+        if (Memory::countsAllocations()) {
+          Logging::report(type, id, std::string(phase_names[phase]) + "_allocations", allocations[phase].count);
+          Logging::report(type, id, std::string(phase_names[phase]) + "_allocated_bytes", allocations[phase].bytes);
+        }
+      }
+      const PerfCounters::Sample& sample = hardware_counters[phase];
+      if (sample.valid) {
+        for (uint8_t event = 0; event < PerfCounters::EventCount; event++) {
+          Logging::report(type, id, std::string(phase_names[phase]) + "_" + PerfCounters::event_names[event], sample.values[event]);
+        }
+        if (sample.values[PerfCounters::Instructions] > 0) {
+          Logging::report(type, id, std::string(phase_names[phase]) + "_llc_misses_per_kilo_instruction",
+            1000. * sample.values[PerfCounters::LLCMisses] / sample.values[PerfCounters::Instructions]);
+        }
+      }
+    }
+    for (uint8_t counter = 0; counter < CounterCount; counter++) {
+      if (counters[counter] > 0) {
+        Logging::report(type, id, counter_names[counter], counters[counter]);
+      }
+    }
+    if (peak_rss > 0) {
+      Logging::report(type, id, "peak_rss", peak_rss);
+    }
+  }
+};
+
+// Time, allocations and hardware counters of the calling thread from construction until stop()
+class Measurement {
+private:
+
+  Timer timer;
+  Memory::Allocations allocations_at_start;
+  PerfCounters::Measurement hardware_counters;
+
+public:
+
+  Measurement() : allocations_at_start(Memory::threadAllocations()) {}
+
+  Sample stop() {
+    return Sample { timer.seconds(), Memory::threadAllocations() - allocations_at_start, hardware_counters.stop() };
+  }
+};
+
+// Measures a phase which runs parts of its work on an OpenMP thread team. Time is the wall clock time of the calling
+// thread, allocations and hardware counters are summed over the calling thread and every team thread between its
+// startThread() and stopThread(). These have to enclose the work of each thread inside the parallel regions.
+class ParallelMeasurement {
+private:
+
+  Timer timer;
+  std::thread::id calling_thread;
+  Measurement calling_thread_measurement;
+  std::mutex mutex;
+  Sample sum;
+
+  static Measurement& threadMeasurement() {
+    thread_local Measurement measurement;
+    return measurement;
+  }
+
+  void add(const Sample& sample) {
+    std::lock_guard<std::mutex> lock(mutex);
+    sum.allocations.count += sample.allocations.count;
+    sum.allocations.bytes += sample.allocations.bytes;
+    sum.hardware_counters += sample.hardware_counters;
+  }
+
+public:
+
+  ParallelMeasurement() : calling_thread(std::this_thread::get_id()) {}
+
+  void startThread() {
+    // the calling thread is part of the team, its own measurement must not be nested
+    if (std::this_thread::get_id() == calling_thread) {
+      add(calling_thread_measurement.stop());
+    }
+    threadMeasurement() = Measurement();
+  }
+
+  void stopThread() {
+    add(threadMeasurement().stop());
+    if (std::this_thread::get_id() == calling_thread) {
+      calling_thread_measurement = Measurement();
+    }
+  }
+
+  Sample stop() {
+    add(calling_thread_measurement.stop());
+    Sample sample = sum;
+    sample.seconds = timer.seconds();
+    return sample;
+  }
+};
+
+// Stats of one (thrill) worker.
+// Measurements go to the record of the level currently processed by this worker
+// or, outside of the levels, to a separate record (e.g. evaluation).
+class Worker {
+private:
+
+  std::deque<LevelRecord> levels;
+  LevelRecord outside_levels;
+  LevelRecord* current_record = &outside_levels;
+
+public:
+
+  LevelRecord& enterLevel(const uint32_t level, const Logging::Id logging_id) {
+    if (levels.size() <= level) {
+      levels.resize(level + 1);
+    }
+    levels[level].logging_id = logging_id;
+    current_record = &levels[level];
+    return *current_record;
+  }
+
+  void leaveLevels() { current_record = &outside_levels; }
+
+  LevelRecord& current() { return *current_record; }
+  const std::deque<LevelRecord>& getLevels() const { return levels; }
+  const LevelRecord& getOutsideLevels() const { return outside_levels; }
+
+  void reset() {
+    levels.clear();
+    outside_levels = LevelRecord();
+    current_record = &outside_levels;
+  }
+};
+
+// thrill runs each worker in its own thread, so every worker collects into its own instance
+thread_local Worker worker;
+
+// Adds the time until destruction (or stop) to the given phase of the current level
+class Scope {
+private:
+
+  LevelRecord* record;
+  Phase phase;
+  Timer timer;
+  Memory::Allocations allocations_at_start;
+
+public:
+
+  Scope(const Phase phase) : record(&worker.current()), phase(phase), allocations_at_start(Memory::threadAllocations()) {}
+  ~Scope() { stop(); }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  void stop() {
+    if (record) {
+      record->add(phase, Sample { timer.seconds(), Memory::threadAllocations() - allocations_at_start, PerfCounters::Sample() });
+      record = nullptr;
+    }
+  }
+};
+
+inline void count(const Counter counter, const uint64_t amount = 1) {
+  worker.current().counters[counter] += amount;
+}
+
+} // PhaseStats
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <thrill/api/dia.hpp>
+#include <thrill/api/generate.hpp>
+#include <thrill/api/group_to_index.hpp>
+#include <thrill/api/sum.hpp>
+#include <thrill/api/write_binary.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "data/thrill/graph.hpp"
+#include "util/graph_generator.hpp"
+
+namespace GraphGenerator {
+
+// Every worker draws the edges of its share of the node ids, duplicates are removed after grouping by tail
+template<class Generator>
+DiaNodeGraph<NodeWithLinks> generateNodeGraph(const Generator& generator, thrill::Context& context) {
+  auto nodes = thrill::Generate(context, generator.node_count)
+    .template FlatMap<Edge>(
+      [generator](const size_t node, auto emit) {
+        generator.forEachEdgeDrawnBy(node, [&emit](const NodeId tail, const NodeId head) {
+          emit(Edge { tail, head });
+          emit(Edge { head, tail });
+        });
+      })
+    .template GroupToIndex<NodeWithLinks>(
+      [](const Edge& edge) -> size_t { return edge.tail; },
+      [](auto& iterator, const NodeId node) {
+        std::vector<NodeId> neighbors;
+        while (iterator.HasNext()) {
+          neighbors.push_back(iterator.Next().head);
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+        NodeWithLinks result { node, {} };
+        result.links.reserve(neighbors.size());
+        for (const NodeId neighbor : neighbors) {
+          result.push_back(EdgeTarget { neighbor });
+        }
+        return result;
+      },
+      generator.node_count)
+    .Cache();
+
+  Weight total_weight = nodes
+    .Keep()
+    .Map([](const NodeWithLinks& node) { return node.links.size(); })
+    .Sum() / 2;
+
+  return DiaNodeGraph<NodeWithLinks> { nodes, generator.node_count, total_weight };
+}
+
+DiaNodeGraph<NodeWithLinks> generateNodeGraph(const std::string& spec, thrill::Context& context) {
+  return Spec(spec).withGenerator([&context](const auto& generator) { return generateNodeGraph(generator, context); });
+}
+
+auto generateGroundTruth(const PlantedPartition& generator, thrill::Context& context) {
+  return thrill::Generate(context, generator.node_count,
+    [generator](const size_t node) { return NodeCluster(node, generator.clusterOf(node)); });
+}
+
+auto generateGroundTruth(const std::string& spec, thrill::Context& context) {
+  return generateGroundTruth(Spec(spec).plantedPartition(), context);
+}
+
+// Writes the graph in the format of preprocess: per node the sorted higher neighbor ids
+void writeBinary(const DiaNodeGraph<NodeWithLinks>& graph, const std::string& output) {
+  graph.nodes
+    .Map(
+      [](const NodeWithLinks& node) {
+        std::vector<NodeId> neighbors;
+        for (const EdgeTarget& link : node.links) {
+          if (link.target > node.id) {
+            neighbors.push_back(link.target);
+          }
+        }
+        return neighbors;
+      })
+    .WriteBinary(output);
+}
+
+} // GraphGenerator
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <thrill/api/all_reduce.hpp>
 #include <thrill/api/cache.hpp>
 #include <thrill/api/dia.hpp>
 #include <thrill/api/group_by_key.hpp>
 #include <thrill/api/inner_join.hpp>
+#include <thrill/api/prefix_sum.hpp>
 #include <thrill/api/read_binary.hpp>
 #include <thrill/api/read_lines.hpp>
 #include <thrill/api/rebalance.hpp>
@@ -12,72 +14,254 @@
 #include <thrill/api/size.hpp>
 #include <thrill/api/sort.hpp>
 #include <thrill/api/sum.hpp>
+#include <thrill/api/uniq.hpp>
+#include <thrill/api/zip.hpp>
 #include <thrill/api/zip_with_index.hpp>
 
 #include <vector>
 #include <iostream>
+#include <limits>
+#include <type_traits>
 
 #include "data/thrill/graph.hpp"
+#include "util/thrill/graph_generator.hpp"
+#include "util/graph_format.hpp"
 
 namespace Input {
 
-template<bool cleanup = true>
-DiaEdgeGraph<Edge> readEdgeListToEdgeGraph(const std::string& file, thrill::Context& context) {
-  auto raw_edges = thrill::ReadLines(context, file)
+// Skips spaces and tabs and parses the following decimal number, false if there is none or it does not fit
+template<typename Number>
+bool parseNumber(const char*& pos, const char* end, Number& number) {
+  while (pos < end && (*pos == ' ' || *pos == '\t')) {
+    pos++;
+  }
+  if (pos == end || *pos < '0' || *pos > '9') {
+    return false;
+  }
+  uint64_t value = 0;
+  while (pos < end && *pos >= '0' && *pos <= '9') {
+    const uint64_t digit = *pos - '0';
+    if (value > (std::numeric_limits<Number>::max() - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+    pos++;
+  }
+  number = value;
+  return true;
+}
+
+bool parseEdge(const std::string& line, Edge& edge) {
+  const char* pos = line.data();
+  const char* end = line.data() + line.size();
+  return parseNumber(pos, end, edge.tail) && parseNumber(pos, end, edge.head);
+}
+
+bool parseEdge(const std::string& line, WeightedEdge& edge) {
+  const char* pos = line.data();
+  const char* end = line.data() + line.size();
+  return parseNumber(pos, end, edge.tail) && parseNumber(pos, end, edge.head) && parseNumber(pos, end, edge.weight);
+}
+
+// One edge per line of a SNAP edge list, WeightedEdges take the weight from the third column
+template<typename EdgeType = Edge>
+auto readEdgeList(const std::string& file, thrill::Context& context) {
+  return thrill::ReadLines(context, file)
     .Filter([](const std::string& line) { return !line.empty() && line[0] != '#'; })
-    .template FlatMap<Edge>(
-      [](const std::string& line, auto emit) {
-        std::istringstream line_stream(line);
-        NodeId tail, head;
-
-        if (line_stream >> tail >> head) {
-          assert(tail != head);
-          emit(Edge { tail, head });
-          emit(Edge { head, tail });
-        } else {
+    .Map(
+      [](const std::string& line) {
+        EdgeType edge;
+        if (!parseEdge(line, edge)) {
           die(std::string("malformatted edge: ") + line);
         }
+        assert(edge.tail != edge.head);
+        return edge;
       });
+}
+
+template<typename EdgeDIA>
+auto withReverseEdges(const EdgeDIA& edges) {
+  using EdgeType = typename EdgeDIA::ValueType;
+
+  return edges
+    .template FlatMap<EdgeType>(
+      [](const EdgeType& edge, auto emit) {
+        emit(edge);
+        EdgeType reverse = edge;
+        reverse.flip();
+        emit(reverse);
+      });
+}
+
+// Sum of the edge weights, for unweighted edges just the edge count
+template<typename EdgeDIA>
+Weight totalWeight(const EdgeDIA& edges, const size_t edge_count) {
+  using EdgeType = typename EdgeDIA::ValueType;
+
+  if (std::is_same<EdgeType, Edge>::value) {
+    return edge_count;
+  }
+  return edges.Keep().Map([](const EdgeType& edge) { return edge.getWeight(); }).Sum();
+}
+
+// Size of the id space if a dense map of it is affordable, that is not much larger than the edge list itself, 0 otherwise
+template<typename EdgeDIA>
+size_t denseIdSpace(const EdgeDIA& edges, const size_t edge_count) {
+  using EdgeType = typename EdgeDIA::ValueType;
+
+  NodeId max_id = edges
+    .Keep()
+    .Map([](const EdgeType& edge) { return std::max(edge.tail, edge.head); })
+    .AllReduce([](const NodeId a, const NodeId b) { return std::max(a, b); });
+  size_t id_space = size_t(max_id) + 1;
+  return id_space <= 4 * edge_count ? id_space : 0;
+}
+
+// Compacts nearly contiguous ids with a range partitioned dense map: a prefix sum over the used ids yields the new ids.
+// Grouping the links by their old tail and zipping with the map renames the tails, sending the renamed tails
+// to their old heads and zipping again renames the heads. The nodes come out ordered by their new id.
+template<typename EdgeDIA>
+auto compactDenseEdgeList(const EdgeDIA& edges, const size_t id_space, const Weight total_weight) {
+  using EdgeType = typename EdgeDIA::ValueType;
+  using NodeType = typename EdgeType::NodeType;
+  using LinkType = typename NodeType::LinkType;
+  // (used, number of used ids up to this one) per old id
+  using UsedCount = std::pair<NodeId, NodeId>;
+
+  auto new_ids = edges
+    .Keep()
+    .template FlatMap<UsedCount>(
+      [](const EdgeType& edge, auto emit) {
+        emit(UsedCount(edge.tail, 1));
+        emit(UsedCount(edge.head, 1));
+      })
+    .ReduceToIndex(
+      [](const UsedCount& id) -> size_t { return id.first; },
+      [](const UsedCount& id, const UsedCount&) { return id; },
+      id_space, UsedCount(0, 0))
+    .Map([](const UsedCount& id) { return UsedCount(id.second, id.second); })
+    .PrefixSum([](const UsedCount& a, const UsedCount& b) { return UsedCount(b.first, a.second + b.second); })
+    .Cache();
+
+  NodeId node_count = new_ids.Keep().Map([](const UsedCount& id) { return id.first; }).Sum();
+
+  auto nodes = withReverseEdges(edges)
+    .template GroupToIndex<std::vector<LinkType>>(
+      [](const EdgeType& edge) -> size_t { return edge.tail; },
+      [](auto& iterator, const size_t) {
+        std::vector<LinkType> links;
+        while (iterator.HasNext()) {
+          links.push_back(LinkType::fromEdge(iterator.Next()));
+        }
+        return links;
+      },
+      id_space)
+    .Zip(new_ids.Keep(),
+      [](const std::vector<LinkType>& links, const UsedCount& id) {
+        return std::make_pair(id.second - 1, links);
+      })
+    .template FlatMap<EdgeType>(
+      [](const std::pair<NodeId, std::vector<LinkType>>& tail, auto emit) {
+        for (const LinkType& link : tail.second) {
+          EdgeType edge = EdgeType::fromLink(tail.first, link);
+          edge.flip();
+          emit(edge);
+        }
+      })
+    .template GroupToIndex<NodeType>(
+      [](const EdgeType& edge) -> size_t { return edge.tail; },
+      [](auto& iterator, const size_t) {
+        NodeType node { 0, {} };
+        while (iterator.HasNext()) {
+          node.push_back(LinkType::fromEdge(iterator.Next()));
+        }
+        return node;
+      },
+      id_space)
+    .Zip(new_ids,
+      [](NodeType node, const UsedCount& id) {
+        node.id = id.first ? id.second - 1 : NodeId(-1);
+        return node;
+      })
+    .Filter([](const NodeType& node) { return node.id != NodeId(-1); })
+    // the filter leaves the nodes in the ranges of the old ids, the local moving expects those of the new ones
+    .Rebalance()
+    .Cache();
+
+  return DiaNodeGraph<NodeType> { nodes, node_count, total_weight };
+}
+
+// Sparse ids are compacted through a sorted mapping, joined first against the tails and then against the heads.
+// Every line is joined as a single edge, the reverse links are added afterwards.
+template<typename EdgeDIA>
+auto compactSparseEdgeList(const EdgeDIA& edges, const Weight total_weight) {
+  using EdgeType = typename EdgeDIA::ValueType;
+
+  auto cleanup_mapping = edges
+    .Keep()
+    .template FlatMap<NodeId>(
+      [](const EdgeType& edge, auto emit) {
+        emit(edge.tail);
+        emit(edge.head);
+      })
+    .Uniq()
+    .Sort()
+    .ZipWithIndex([](const NodeId old_id, const NodeId index) { return std::make_pair(old_id, index); });
+
+  NodeId node_count = cleanup_mapping.Keep().Size();
+
+  auto compacted_edges = edges
+    .InnerJoin(
+      cleanup_mapping.Keep(),
+      [](const EdgeType& edge) { return edge.tail; },
+      [](const std::pair<NodeId, NodeId>& mapping) { return mapping.first; },
+      [](EdgeType edge, const std::pair<NodeId, NodeId>& mapping) { edge.tail = mapping.second; return edge; })
+    .InnerJoin(
+      cleanup_mapping,
+      [](const EdgeType& edge) { return edge.head; },
+      [](const std::pair<NodeId, NodeId>& mapping) { return mapping.first; },
+      [](EdgeType edge, const std::pair<NodeId, NodeId>& mapping) { edge.head = mapping.second; return edge; });
+
+  return DiaEdgeGraph<EdgeType> { withReverseEdges(compacted_edges).Collapse(), node_count, total_weight };
+}
 
-  Weight total_weight = raw_edges.Keep().Size() / 2;
+template<bool cleanup = true, typename EdgeType = Edge>
+DiaEdgeGraph<EdgeType> readEdgeListToEdgeGraph(const std::string& file, thrill::Context& context) {
+  auto edges = readEdgeList<EdgeType>(file, context).Cache();
+  size_t edge_count = edges.Keep().Size();
+  Weight total_weight = totalWeight(edges, edge_count);
 
   if (cleanup) {
-    auto cleanup_mapping = raw_edges
-      .Keep()
-      .Map([](const Edge& edge) { return edge.tail; })
-      .Uniq()
-      .Sort()
-      .ZipWithIndex([](const NodeId old_id, const NodeId index) { return std::make_pair(old_id, index); });
-
-    NodeId node_count = cleanup_mapping.Keep().Size();
-
-    auto edges = raw_edges
-      .InnerJoin(
-        cleanup_mapping,
-        [](const Edge& edge) { return edge.tail; },
-        [](const std::pair<NodeId, NodeId>& mapping) { return mapping.first; },
-        [](const Edge& edge, const std::pair<NodeId, NodeId>& mapping) { return Edge { mapping.second, edge.head }; })
-      .InnerJoin(
-        cleanup_mapping,
-        [](const Edge& edge) { return edge.head; },
-        [](const std::pair<NodeId, NodeId>& mapping) { return mapping.first; },
-        [](const Edge& edge, const std::pair<NodeId, NodeId>& mapping) { return Edge { edge.tail, mapping.second }; });
-
-    return DiaEdgeGraph<Edge> { edges, node_count, total_weight };
+    size_t id_space = denseIdSpace(edges, edge_count);
+    if (id_space > 0) {
+      auto graph = compactDenseEdgeList(edges, id_space, total_weight);
+      return DiaEdgeGraph<EdgeType> { nodesToEdges(graph.nodes).Collapse(), graph.node_count, graph.total_weight };
+    }
+    return compactSparseEdgeList(edges, total_weight);
   } else {
-    size_t node_count = raw_edges.Keep().Map([](const Edge& edge) { return edge.tail; }).Uniq().Size();
-    return DiaEdgeGraph<Edge> { raw_edges.Collapse(), node_count, total_weight };
+    auto raw_edges = withReverseEdges(edges);
+    size_t node_count = raw_edges.Keep().Map([](const EdgeType& edge) { return edge.tail; }).Uniq().Size();
+    return DiaEdgeGraph<EdgeType> { raw_edges.Collapse(), node_count, total_weight };
   }
 }
 
-DiaGraph<NodeWithLinks, Edge> readEdgeListGraph(const std::string& file, thrill::Context& context) {
-  auto graph = readEdgeListToEdgeGraph(file, context);
-  return DiaGraph<NodeWithLinks, Edge> { edgesToNodes(graph.edges.Keep(), graph.node_count), graph.edges, graph.node_count, graph.total_weight };
+template<typename EdgeType = Edge>
+DiaNodeGraph<typename EdgeType::NodeType> readEdgeListToNodeGraph(const std::string& file, thrill::Context& context) {
+  auto edges = readEdgeList<EdgeType>(file, context).Cache();
+  size_t edge_count = edges.Keep().Size();
+  Weight total_weight = totalWeight(edges, edge_count);
+
+  size_t id_space = denseIdSpace(edges, edge_count);
+  if (id_space > 0) {
+    return compactDenseEdgeList(edges, id_space, total_weight);
+  }
+  auto graph = compactSparseEdgeList(edges, total_weight);
+  return DiaNodeGraph<typename EdgeType::NodeType> { edgesToNodes(graph.edges, graph.node_count), graph.node_count, graph.total_weight };
 }
 
-DiaNodeGraph<NodeWithLinks> readEdgeListToNodeGraph(const std::string& file, thrill::Context& context) {
-  auto graph = readEdgeListToEdgeGraph(file, context);
-  return DiaNodeGraph<NodeWithLinks> { edgesToNodes(graph.edges, graph.node_count), graph.node_count, graph.total_weight };
+DiaGraph<NodeWithLinks, Edge> readEdgeListGraph(const std::string& file, thrill::Context& context) {
+  auto graph = readEdgeListToNodeGraph(file, context);
+  return DiaGraph<NodeWithLinks, Edge> { graph.nodes, nodesToEdges(graph.nodes.Keep()).Collapse(), graph.node_count, graph.total_weight };
 }
 
 
@@ -161,6 +345,121 @@ DiaNodeGraph<NodeWithLinks> readBinaryToNodeGraph(const std::string& file, thril
   return DiaNodeGraph<NodeWithLinks> { edgesToNodes(graph.edges, graph.node_count), graph.node_count, graph.total_weight };
 }
 
+// Written by preprocess with SYMMETRIC=1, every node stores all its neighbors.
+// Workers turn the nodes of their file ranges directly into NodeWithLinks, no edges are shuffled.
+// Those ranges follow the file sizes, so the nodes are rebalanced once to the id ranges of the workers,
+// which the index aligned zips of the local moving expect. Moving n nodes once is still much cheaper than shuffling 2m edges.
+DiaNodeGraph<NodeWithLinks> readSymmetricBinaryToNodeGraph(const std::string& file, thrill::Context& context) {
+  auto nodes = thrill::ReadBinary<std::vector<NodeId>>(context, file)
+    .ZipWithIndex(
+      [](const std::vector<NodeId>& neighbors, const NodeId node) {
+        NodeWithLinks node_with_links { node, {} };
+        node_with_links.links.reserve(neighbors.size());
+        for (const NodeId neighbor : neighbors) {
+          assert(node != neighbor);
+          node_with_links.push_back(EdgeTarget { neighbor });
+        }
+        return node_with_links;
+      })
+    .Rebalance()
+    .Cache();
+
+  NodeId node_count = nodes.Keep().Size();
+  Weight total_weight = nodes
+    .Keep()
+    .Map([](const NodeWithLinks& node) { return node.links.size(); })
+    .Sum() / 2;
+
+  return DiaNodeGraph<NodeWithLinks> { nodes, node_count, total_weight };
+}
+
+DiaGraph<NodeWithLinks, Edge> readSymmetricBinaryGraph(const std::string& file, thrill::Context& context) {
+  auto graph = readSymmetricBinaryToNodeGraph(file, context);
+  return DiaGraph<NodeWithLinks, Edge> { graph.nodes, nodesToEdges(graph.nodes.Keep()).Collapse(), graph.node_count, graph.total_weight };
+}
+
+DiaEdgeGraph<Edge> readSymmetricBinaryToEdgeGraph(const std::string& file, thrill::Context& context) {
+  auto graph = readSymmetricBinaryToNodeGraph(file, context);
+  return DiaEdgeGraph<Edge> { nodesToEdges(graph.nodes).Collapse(), graph.node_count, graph.total_weight };
+}
+
+
+// DIMACS graph with edge weights, every line alternates neighbors and weights
+DiaNodeGraph<NodeWithWeightedLinks> readWeightedDimacsToNodeGraph(const std::string& file, thrill::Context& context) {
+  auto lines = thrill::ReadLines(context, file).Rebalance();
+
+  NodeId node_count = lines.Keep().Size() - 1;
+
+  auto nodes = lines
+    .ZipWithIndex([](const std::string line, const size_t index) { return std::make_pair(line, index); })
+    .Filter([](const std::pair<std::string, size_t>& node) { return node.second > 0; })
+    .Map(
+      [](const std::pair<std::string, size_t>& node) {
+        const char* pos = node.first.data();
+        const char* end = node.first.data() + node.first.size();
+        NodeWithWeightedLinks node_with_links { NodeId(node.second - 1), {} };
+        NodeId neighbor;
+        Weight weight;
+
+        while (parseNumber(pos, end, neighbor)) {
+          if (!parseNumber(pos, end, weight)) {
+            die(std::string("neighbor without weight: ") + node.first);
+          }
+          assert(node.second != neighbor);
+          node_with_links.push_back(WeightedEdgeTarget { neighbor - 1, weight });
+        }
+
+        assert(!node_with_links.links.empty());
+
+        return node_with_links;
+      })
+    .Rebalance();
+
+  Weight total_weight = nodes
+    .Keep()
+    .Map([](const NodeWithWeightedLinks& node) { return node.weightedDegree(); })
+    .Sum() / 2;
+
+  return DiaNodeGraph<NodeWithWeightedLinks> { nodes, node_count, total_weight };
+}
+
+// Written by preprocess with WEIGHTED=1, every node stores its neighbors and then their weights.
+// Like unweighted files they hold each link once at its lower node unless they are symmetric (*.weighted.sym.bin).
+using WeightedAdjacency = std::pair<std::vector<NodeId>, std::vector<Weight>>;
+
+DiaNodeGraph<NodeWithWeightedLinks> readWeightedBinaryToNodeGraph(const std::string& file, thrill::Context& context) {
+  auto input = thrill::ReadBinary<WeightedAdjacency>(context, file)
+    .ZipWithIndex(
+      [](const WeightedAdjacency& adjacency, const NodeId node) {
+        assert(adjacency.first.size() == adjacency.second.size());
+        NodeWithWeightedLinks node_with_links { node, {} };
+        node_with_links.links.reserve(adjacency.first.size());
+        for (size_t i = 0; i < adjacency.first.size(); i++) {
+          assert(node != adjacency.first[i]);
+          node_with_links.push_back(WeightedEdgeTarget { adjacency.first[i], adjacency.second[i] });
+        }
+        return node_with_links;
+      })
+    .Cache();
+
+  NodeId node_count = input.Keep().Size();
+
+  thrill::DIA<NodeWithWeightedLinks> nodes;
+  if (GraphFormat::endsWith(file, ".sym.bin")) {
+    // from the file ranges to the id ranges of the workers, see readSymmetricBinaryToNodeGraph
+    nodes = input.Rebalance();
+  } else {
+    nodes = edgesToNodes(withReverseEdges(nodesToEdges(input)), node_count);
+  }
+
+  Weight total_weight = nodes
+    .Keep()
+    .Map([](const NodeWithWeightedLinks& node) { return node.weightedDegree(); })
+    .Sum() / 2;
+
+  return DiaNodeGraph<NodeWithWeightedLinks> { nodes, node_count, total_weight };
+}
+
 
 bool ends_with(const std::string& value, const std::string& ending) {
   if (ending.size() > value.size()) return false;
@@ -172,11 +471,22 @@ bool begins_with(const std::string& value, const std::string& begin) {
   return std::equal(begin.begin(), begin.end(), value.begin());
 }
 
+// "generate:<spec>" instead of a file generates the graph, see GraphGenerator::Spec
+const std::string generator_prefix = "generate:";
+
 DiaGraph<NodeWithLinks, Edge> readGraph(const std::string& file, thrill::Context& context) {
-  if (ends_with(file, ".graph")) {
+  if (GraphFormat::isWeighted(file)) {
+    throw "weighted graph input, use readToWeightedNodeGraph";
+  }
+  if (begins_with(file, generator_prefix)) {
+    auto graph = GraphGenerator::generateNodeGraph(file.substr(generator_prefix.size()), context);
+    return DiaGraph<NodeWithLinks, Edge> { graph.nodes, nodesToEdges(graph.nodes.Keep()).Collapse(), graph.node_count, graph.total_weight };
+  } else if (ends_with(file, ".graph")) {
     return readDimacsGraph(file, context);
   } else if (ends_with(file, ".txt")) {
     return readEdgeListGraph(file, context);
+  } else if (ends_with(file, ".sym.bin")) {
+    return readSymmetricBinaryGraph(file, context);
   } else if (ends_with(file, ".bin")) {
     return readBinaryGraph(file, context);
   } else {
@@ -186,10 +496,18 @@ DiaGraph<NodeWithLinks, Edge> readGraph(const std::string& file, thrill::Context
 
 template<bool cleanup = true>
 DiaEdgeGraph<Edge> readToEdgeGraph(const std::string& file, thrill::Context& context) {
-  if (ends_with(file, ".graph")) {
+  if (GraphFormat::isWeighted(file)) {
+    throw "weighted graph input, use readToWeightedNodeGraph";
+  }
+  if (begins_with(file, generator_prefix)) {
+    auto graph = GraphGenerator::generateNodeGraph(file.substr(generator_prefix.size()), context);
+    return DiaEdgeGraph<Edge> { nodesToEdges(graph.nodes).Collapse(), graph.node_count, graph.total_weight };
+  } else if (ends_with(file, ".graph")) {
     return readDimacsToEdgeGraph(file, context);
   } else if (ends_with(file, ".txt")) {
     return readEdgeListToEdgeGraph<cleanup>(file, context);
+  } else if (ends_with(file, ".sym.bin")) {
+    return readSymmetricBinaryToEdgeGraph(file, context);
   } else if (ends_with(file, ".bin")) {
     return readBinaryToEdgeGraph(file, context);
   } else {
@@ -199,10 +517,17 @@ DiaEdgeGraph<Edge> readToEdgeGraph(const std::string& file, thrill::Context& con
 
 
 DiaNodeGraph<NodeWithLinks> readToNodeGraph(const std::string& file, thrill::Context& context) {
-  if (ends_with(file, ".graph")) {
+  if (GraphFormat::isWeighted(file)) {
+    throw "weighted graph input, use readToWeightedNodeGraph";
+  }
+  if (begins_with(file, generator_prefix)) {
+    return GraphGenerator::generateNodeGraph(file.substr(generator_prefix.size()), context);
+  } else if (ends_with(file, ".graph")) {
     return readDimacsToNodeGraph(file, context);
   } else if (ends_with(file, ".txt")) {
     return readEdgeListToNodeGraph(file, context);
+  } else if (ends_with(file, ".sym.bin")) {
+    return readSymmetricBinaryToNodeGraph(file, context);
   } else if (ends_with(file, ".bin")) {
     return readBinaryToNodeGraph(file, context);
   } else {
@@ -210,8 +535,32 @@ DiaNodeGraph<NodeWithLinks> readToNodeGraph(const std::string& file, thrill::Con
   }
 }
 
+// Weighted DIMACS graphs, edge lists with weights and weighted binary graphs, see GraphFormat
+DiaNodeGraph<NodeWithWeightedLinks> readToWeightedNodeGraph(const std::string& file, thrill::Context& context) {
+  if (ends_with(file, ".graph")) {
+    return readWeightedDimacsToNodeGraph(file, context);
+  } else if (ends_with(file, ".txt")) {
+    return readEdgeListToNodeGraph<WeightedEdge>(file, context);
+  } else if (GraphFormat::isWeightedBin(file)) {
+    return readWeightedBinaryToNodeGraph(file, context);
+  } else {
+    throw "unknown weighted graph input";
+  }
+}
+
+template<bool cleanup = true>
+DiaEdgeGraph<WeightedEdge> readToWeightedEdgeGraph(const std::string& file, thrill::Context& context) {
+  if (ends_with(file, ".txt")) {
+    return readEdgeListToEdgeGraph<cleanup, WeightedEdge>(file, context);
+  }
+  auto graph = readToWeightedNodeGraph(file, context);
+  return DiaEdgeGraph<WeightedEdge> { nodesToEdges(graph.nodes).Collapse(), graph.node_count, graph.total_weight };
+}
+
 auto readClustering(const std::string& file, thrill::Context& context) {
-  if (ends_with(file, ".bin")) {
+  if (begins_with(file, generator_prefix)) {
+    return GraphGenerator::generateGroundTruth(file.substr(generator_prefix.size()), context).Collapse();
+  } else if (ends_with(file, ".bin")) {
     return thrill::ReadBinary<NodeCluster>(context, file);
   } else {
     return thrill::ReadLines(context, file)
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <thrill/api/context.hpp>
+
+#include <algorithm>
+#include <assert.h>
+#include <vector>
+
+#include "util/phase_stats.hpp"
+
+namespace PhaseStats {
+
+// layout: phase times, allocated bytes per phase, counters, peak rss
+constexpr size_t allocations_offset = PhaseCount;
+constexpr size_t counters_offset = 2 * PhaseCount;
+constexpr size_t peak_rss_offset = counters_offset + CounterCount;
+constexpr size_t values_per_record = peak_rss_offset + 1;
+
+void appendValues(const LevelRecord& record, std::vector<double>& values) {
+  for (uint8_t phase = 0; phase < PhaseCount; phase++) {
+    values.push_back(record.seconds[phase]);
+  }
+  for (uint8_t phase = 0; phase < PhaseCount; phase++) {
+    values.push_back(record.allocations[phase].bytes);
+  }
+  for (uint8_t counter = 0; counter < CounterCount; counter++) {
+    values.push_back(record.counters[counter]);
+  }
+  values.push_back(record.peak_rss);
+}
+
+template<class IdType>
+void reportAggregated(const std::string& type, const IdType id, const LevelRecord& own_record, const double* min, const double* sum, const double* max, const size_t num_workers) {
+  const auto report = [&](const std::string& name, const size_t index) {
+    Logging::report(type, id, name + "_min", min[index]);
+    Logging::report(type, id, name + "_avg", sum[index] / num_workers);
+    Logging::report(type, id, name + "_max", max[index]);
+  };
+
+  for (uint8_t phase = 0; phase < PhaseCount; phase++) {
+    if (own_record.rounds[phase] > 0) {
+      report(std::string(phase_names[phase]) + "_time", phase);
+      Logging::report(type, id, std::string(phase_names[phase]) + "_rounds", own_record.rounds[phase]);
+      if (Memory::countsAllocations()) {
+        report(std::string(phase_names[phase]) + "_allocated_bytes", allocations_offset + phase);
+      }
+    }
+  }
+  for (uint8_t counter = 0; counter < CounterCount; counter++) {
+    if (max[counters_offset + counter] > 0) {
+      report(counter_names[counter], counters_offset + counter);
+    }
+  }
+  if (max[peak_rss_offset] > 0) {
+    report("peak_rss", peak_rss_offset);
+  }
+}
+
+// Collective operation, has to be called by all workers.
+// Reports min/avg/max over all workers of every phase time, counter and the peak rss per level
+// to the respective algorithm_level and the evaluation to the algorithm_run.
+void reportAcrossWorkers(thrill::Context& context, const Logging::Id algorithm_run_id) {
+  const size_t level_count = context.net.AllReduce(worker.getLevels().size(), [](const size_t a, const size_t b) { return std::max(a, b); });
+
+  std::vector<double> values;
+  values.reserve((level_count + 1) * values_per_record);
+  for (size_t level = 0; level < level_count; level++) {
+    appendValues(level < worker.getLevels().size() ? worker.getLevels()[level] : LevelRecord(), values);
+  }
+  appendValues(worker.getOutsideLevels(), values);
+
+  const auto elementwise = [](const auto& op) {
+    return [op](const std::vector<double>& a, const std::vector<double>& b) {
+      assert(a.size() == b.size());
+      std::vector<double> result(a.size());
+      std::transform(a.begin(), a.end(), b.begin(), result.begin(), op);
+      return result;
+    };
+  };
+
+  const std::vector<double> min = context.net.AllReduce(values, elementwise([](double a, double b) { return std::min(a, b); }));
+  const std::vector<double> sum = context.net.AllReduce(values, elementwise([](double a, double b) { return a + b; }));
+  const std::vector<double> max = context.net.AllReduce(values, elementwise([](double a, double b) { return std::max(a, b); }));
+
+  if (context.my_rank() == 0) {
+    for (size_t level = 0; level < worker.getLevels().size(); level++) {
+      const size_t offset = level * values_per_record;
+      reportAggregated("algorithm_level", worker.getLevels()[level].logging_id, worker.getLevels()[level], &min[offset], &sum[offset], &max[offset], context.num_workers());
+    }
+    const size_t offset = level_count * values_per_record;
+    reportAggregated("algorithm_run", algorithm_run_id, worker.getOutsideLevels(), &min[offset], &sum[offset], &max[offset], context.num_workers());
+  }
+}
+
+} // PhaseStats
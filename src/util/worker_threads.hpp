@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+// Threads every thrill worker may use for heavy per cluster or per partition bodies.
+// Set WORKER_THREADS to run fewer workers per host with more threads each, defaults to 1.
+// The threads are OpenMP teams of the calling worker thread, configure() has to run on each worker.
+namespace WorkerThreads {
+
+// bodies with less work (usually links) than this stay on the calling thread
+constexpr size_t min_parallel_work = 1 << 16;
+
+uint32_t count() {
+  static const uint32_t threads = getenv("WORKER_THREADS") ? std::max(1, std::stoi(getenv("WORKER_THREADS"))) : 1;
+  return threads;
+}
+
+void configure() {
+  omp_set_num_threads(count());
+}
+
+uint32_t shardsFor(const size_t work) {
+  return work >= min_parallel_work ? count() : 1;
+}
+
+// calls f(shard) for every shard in [0, shards), in parallel if there is more than one
+template<class F>
+void forEachShard(const uint32_t shards, const F& f) {
+  #pragma omp parallel for schedule(static, 1) if(shards > 1)
+  for (uint32_t shard = 0; shard < shards; shard++) {
+    f(shard);
+  }
+}
+
+// Sums the values for_each(item, emit) emits by key over all items, on shards threads.
+// Every thread buckets what a contiguous range of items carrying about the same work emits by key shard,
+// then every thread sums up the buckets of its key shard, so each value is read and inserted once.
+// Key k ends up in the returned map k % shards.
+template<class Map, class Items, class ItemWork, class ForEach>
+std::vector<Map> sumByKey(const Items& items, const uint32_t shards, const ItemWork& item_work, const ForEach& for_each) {
+  using Key = typename Map::key_type;
+  using Value = typename Map::mapped_type;
+
+  std::vector<Map> shard_sums(shards);
+  if (shards == 1) {
+    for (const auto& item : items) {
+      for_each(item, [&shard_sums](const Key key, const Value value) { shard_sums[0][key] += value; });
+    }
+    return shard_sums;
+  }
+
+  size_t total_work = 0;
+  for (const auto& item : items) {
+    total_work += item_work(item);
+  }
+  std::vector<size_t> range_begin(shards + 1, items.size());
+  range_begin[0] = 0;
+  size_t work = 0;
+  uint32_t range = 1;
+  for (size_t i = 0; i < items.size() && range < shards; i++) {
+    work += item_work(items[i]);
+    while (range < shards && work * shards >= total_work * range) {
+      range_begin[range++] = i + 1;
+    }
+  }
+
+  std::vector<std::vector<std::vector<std::pair<Key, Value>>>> buckets(shards, std::vector<std::vector<std::pair<Key, Value>>>(shards));
+  forEachShard(shards, [&](const uint32_t range) {
+    auto& range_buckets = buckets[range];
+    for (size_t i = range_begin[range]; i < range_begin[range + 1]; i++) {
+      for_each(items[i], [&range_buckets, shards](const Key key, const Value value) {
+        range_buckets[key % shards].emplace_back(key, value);
+      });
+    }
+  });
+
+  forEachShard(shards, [&](const uint32_t shard) {
+    for (uint32_t range = 0; range < shards; range++) {
+      for (const auto& entry : buckets[range][shard]) {
+        shard_sums[shard][entry.first] += entry.second;
+      }
+      std::vector<std::pair<Key, Value>>().swap(buckets[range][shard]);
+    }
+  });
+  return shard_sums;
+}
+
+} // WorkerThreads